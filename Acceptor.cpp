@@ -1,4 +1,5 @@
 #include "Acceptor.h"
+#include "FlightRecorder.h"
 #include "SocketOps.h"
 
 namespace snet
@@ -6,20 +7,20 @@ namespace snet
 
 Acceptor::Acceptor(const std::string &ip, unsigned short port,
                    EventLoop *loop, int backlog)
-    : fd_(-1),
+    : EventHandler(kHandlerTag),
+      fd_(-1),
       backlog_(backlog),
       listen_ok_(false),
       connection_with_el_(true),
-      loop_(loop),
-      eh_(this)
+      loop_(loop)
 {
     if (CreateListenSocket(ip, port))
-        loop_->AddEventHandler(&eh_);
+        loop_->AddEventHandler(this);
 }
 
 Acceptor::~Acceptor()
 {
-    loop_->DelEventHandler(&eh_);
+    loop_->DelEventHandler(this);
 
     if (fd_ >= 0)
         close(fd_);
@@ -30,9 +31,9 @@ bool Acceptor::IsListenOk() const
     return listen_ok_;
 }
 
-void Acceptor::SetOnNewConnection(const OnNewConnection &onc)
+void Acceptor::SetOnNewConnection(OnNewConnection onc)
 {
-    onc_ = onc;
+    onc_ = std::move(onc);
 }
 
 void Acceptor::SetNewConnectionWithEventLoop(bool flag)
@@ -79,6 +80,15 @@ void Acceptor::HandleAccept()
         return ;
     }
 
+    SNET_TRACE(ConnectionAccepted, new_fd, 0);
+
+    // Nobody takes the connection before OnNewConnection is set.
+    if (!onc_)
+    {
+        close(new_fd);
+        return ;
+    }
+
     auto loop = connection_with_el_ ? loop_ : nullptr;
     onc_(ConnectionPtr(new Connection(new_fd, loop)));
 }
@@ -2,19 +2,19 @@
 #define ACCEPTOR_H
 
 #include "Connection.h"
+#include "Delegate.h"
 #include "EventLoop.h"
 #include <string>
 #include <memory>
-#include <functional>
 
 namespace snet
 {
 
-class Acceptor final
+class Acceptor final : private EventHandler
 {
 public:
     using ConnectionPtr = std::unique_ptr<Connection>;
-    using OnNewConnection = std::function<void (ConnectionPtr)>;
+    using OnNewConnection = Delegate<void (ConnectionPtr)>;
 
     Acceptor(const std::string &ip, unsigned short port,
              EventLoop *loop, int backlog = kDefaultBacklog);
@@ -24,46 +24,39 @@ public:
     void operator = (const Acceptor &) = delete;
 
     bool IsListenOk() const;
-    void SetOnNewConnection(const OnNewConnection &onc);
+
+    // Connections are made in the thread of the acceptor loop, from the
+    // slab of that thread, even when they are handed to other loops.
+    void SetOnNewConnection(OnNewConnection onc);
     void SetNewConnectionWithEventLoop(bool flag);
 
 private:
-    class AcceptorEventHandler final : public EventHandler
-    {
-    public:
-        explicit AcceptorEventHandler(Acceptor *acceptor)
-            : acceptor_(acceptor)
-        {
-        }
+    template<typename... Handlers>
+    friend class EventDispatcher;
 
-        AcceptorEventHandler(const AcceptorEventHandler &) = delete;
-        void operator = (const AcceptorEventHandler &) = delete;
+    static const HandlerTag kHandlerTag = kAcceptorHandlerTag;
 
-        virtual int Fd() const override
-        {
-            return acceptor_->fd_;
-        }
-
-        virtual Event Events() const override
-        {
-            return Event::Read;
-        }
+    virtual int Fd() const override
+    {
+        return fd_;
+    }
 
-        virtual Event EnabledEvents() const override
-        {
-            return Event::Read;
-        }
+    virtual Event Events() const override
+    {
+        return Event::Read;
+    }
 
-        virtual void HandleRead() override
-        {
-            acceptor_->HandleAccept();
-        }
+    virtual Event EnabledEvents() const override
+    {
+        return Event::Read;
+    }
 
-        virtual void HandleWrite() override { }
+    virtual void HandleRead() override
+    {
+        HandleAccept();
+    }
 
-    private:
-        Acceptor *acceptor_;
-    };
+    virtual void HandleWrite() override { }
 
     bool CreateListenSocket(const std::string &ip, unsigned short port);
     void HandleAccept();
@@ -76,7 +69,6 @@ private:
     bool connection_with_el_;
     EventLoop *loop_;
     OnNewConnection onc_;
-    AcceptorEventHandler eh_;
 };
 
 } // namespace snet
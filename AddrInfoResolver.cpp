@@ -1,4 +1,6 @@
 #include "AddrInfoResolver.h"
+#include "Affinity.h"
+#include "MessageQueue.h"
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
@@ -9,15 +11,15 @@
 namespace snet
 {
 
-struct AddrInfoResolver::Request
+struct AddrInfoResolver::Request : MpscNode
 {
     const std::string host;
     OnResolve on_resolve;
     struct addrinfo *result;
 
-    Request(const std::string &h, const OnResolve &onr)
+    Request(const std::string &h, OnResolve onr)
         : host(h),
-          on_resolve(onr),
+          on_resolve(std::move(onr)),
           result(nullptr)
     {
     }
@@ -35,9 +37,11 @@ struct AddrInfoResolver::Request
 class AddrInfoResolver::Resolver final
 {
 public:
-    explicit Resolver(snet::MessageQueue<Request *> *resolved)
+    // Thread is pinned to cpu when it is not negative.
+    Resolver(MpscQueue<Request> *resolved, int cpu)
         : resolved_(resolved),
           counter_(0),
+          cpu_(cpu),
           thread_(&Resolver::ResolveFunc, this)
     {
     }
@@ -66,6 +70,9 @@ public:
 private:
     void ResolveFunc()
     {
+        if (cpu_ >= 0)
+            PinCurrentThreadToCpu(cpu_);
+
         while (true)
         {
             auto request = requests_.Recv();
@@ -84,17 +91,20 @@ private:
     }
 
     snet::MessageQueue<Request *> requests_;
-    snet::MessageQueue<Request *> *resolved_;
+    MpscQueue<Request> *resolved_;
     std::atomic<int> counter_;
+    int cpu_;
     std::thread thread_;
 };
 
-AddrInfoResolver::AddrInfoResolver(std::size_t resolver_num)
+AddrInfoResolver::AddrInfoResolver(std::size_t resolver_num,
+                                   const std::vector<int> &cpus)
 {
     for (std::size_t i = 0; i < resolver_num; ++i)
     {
+        auto cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
         resolvers_.push_back(
-            std::unique_ptr<Resolver>(new Resolver(&resolved_)));
+            std::unique_ptr<Resolver>(new Resolver(&resolved_, cpu)));
     }
 }
 
@@ -103,9 +113,9 @@ AddrInfoResolver::~AddrInfoResolver()
 }
 
 const AddrInfoResolver::Request * AddrInfoResolver::AsyncResolve(
-    const std::string &host, const OnResolve &on_resolve)
+    const std::string &host, OnResolve on_resolve)
 {
-    auto req = new Request(host, on_resolve);
+    auto req = new Request(host, std::move(on_resolve));
     std::unique_ptr<Request> request(req);
 
     requests_.push_back(std::move(request));
@@ -128,17 +138,24 @@ void AddrInfoResolver::CancelRequest(const Request *request)
     }
 }
 
+std::size_t AddrInfoResolver::GetQueuedRequests() const
+{
+    std::size_t queued = 0;
+    for (auto &resolver : resolvers_)
+        queued += resolver->GetRequestCount();
+    return queued;
+}
+
 void AddrInfoResolver::HandleLoop()
 {
     if (!requests_.empty())
     {
         while (true)
         {
-            auto resolved = resolved_.TryRecv();
-            if (!resolved)
+            auto request = resolved_.TryRecv();
+            if (!request)
                 break;
 
-            auto request = *resolved;
             HandleResolve(*request);
             RemoveRequest(request);
         }
@@ -1,10 +1,10 @@
 #ifndef ADDR_INFO_RESOLVER_H
 #define ADDR_INFO_RESOLVER_H
 
+#include "Delegate.h"
 #include "EventLoop.h"
-#include "MessageQueue.h"
+#include "MpscQueue.h"
 #include <arpa/inet.h>
-#include <functional>
 #include <vector>
 #include <string>
 #include <memory>
@@ -17,18 +17,28 @@ class AddrInfoResolver final : public LoopHandler
 public:
     struct Request;
     using SockAddrs = std::vector<const struct sockaddr *>;
-    using OnResolve = std::function<void (const SockAddrs &)>;
 
-    explicit AddrInfoResolver(std::size_t resolver_num);
+    // Resolve callbacks usually capture the host name, keep more room
+    // for them, requests are allocated anyway.
+    using OnResolve = Delegate<void (const SockAddrs &), 8 * sizeof(void *)>;
+
+    // Resolver threads are pinned to cpus in turn when cpus is not empty.
+    explicit AddrInfoResolver(std::size_t resolver_num,
+                              const std::vector<int> &cpus =
+                              std::vector<int>());
     ~AddrInfoResolver();
 
     AddrInfoResolver(const AddrInfoResolver &) = delete;
     void operator = (const AddrInfoResolver &) = delete;
 
     const Request * AsyncResolve(const std::string &host,
-                                 const OnResolve &on_resolve);
+                                 OnResolve on_resolve);
     void CancelRequest(const Request *request);
 
+    // Requests waiting for or being resolved by the resolver threads,
+    // it is safe to call from any thread.
+    std::size_t GetQueuedRequests() const;
+
     virtual void HandleLoop() override;
     virtual void HandleStop() override;
 
@@ -39,7 +49,8 @@ private:
     void HandleResolve(const Request &request);
     void RemoveRequest(const Request *request);
 
-    snet::MessageQueue<Request *> resolved_;
+    // Resolver threads send resolved requests to the loop.
+    MpscQueue<Request> resolved_;
     std::vector<std::unique_ptr<Request>> requests_;
     std::vector<std::unique_ptr<Resolver>> resolvers_;
 };
@@ -0,0 +1,331 @@
+#include "AdminServer.h"
+#include "AddrInfoResolver.h"
+#include "SendQueueBudget.h"
+#include "Slab.h"
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace snet
+{
+
+namespace
+{
+
+const std::size_t kMaxRequestSize = 4096;
+
+using Fields = std::vector<std::pair<const char *, uint64_t>>;
+
+Fields LoopFields(const LoopStats &stats)
+{
+    return Fields{
+        { "iterations", stats.iterations },
+        { "events", stats.events },
+        { "blocked_ns", stats.blocked_ns },
+        { "busy_ns", stats.busy_ns },
+        { "callbacks", stats.callbacks },
+        { "ctl_calls", stats.ctl_calls },
+        { "handlers", stats.handlers },
+        { "timers_pending", stats.timers_pending },
+        { "late_timers", stats.late_timers },
+        { "bytes_sent", stats.bytes_sent },
+        { "bytes_received", stats.bytes_received },
+        { "messages_sent", stats.messages_sent },
+        { "messages_received", stats.messages_received },
+        { "send_blocked_ns", stats.send_blocked_ns },
+    };
+}
+
+Fields ProcessFields()
+{
+    auto slab = SlabCounter::GetStats();
+    return Fields{
+        { "queued_send_bytes", GetTotalQueuedSendBytes() },
+        { "send_queue_evictions", SendQueueBudget::GetTotalEvictions() },
+        { "slab_reserved_bytes", slab.reserved_bytes },
+        { "slab_used_bytes", slab.used_bytes },
+    };
+}
+
+void AppendText(std::string &out, const std::string &prefix,
+                const Fields &fields)
+{
+    for (auto &field : fields)
+    {
+        out += prefix;
+        out += field.first;
+        out += ' ';
+        out += std::to_string(static_cast<unsigned long long>(field.second));
+        out += '\n';
+    }
+}
+
+void AppendJsonString(std::string &out, const std::string &str)
+{
+    out += '"';
+    for (auto c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void AppendJson(std::string &out, const Fields &fields)
+{
+    out += '{';
+    for (std::size_t i = 0; i < fields.size(); ++i)
+    {
+        if (i)
+            out += ',';
+        out += '"';
+        out += fields[i].first;
+        out += "\":";
+        out += std::to_string(
+            static_cast<unsigned long long>(fields[i].second));
+    }
+    out += '}';
+}
+
+template<typename Sources, typename GetFields>
+void AppendJsonSources(std::string &out, const char *key,
+                       const Sources &sources, GetFields get_fields)
+{
+    out += '"';
+    out += key;
+    out += "\":{";
+    for (std::size_t i = 0; i < sources.size(); ++i)
+    {
+        if (i)
+            out += ',';
+        AppendJsonString(out, sources[i].first);
+        out += ':';
+        AppendJson(out, get_fields(sources[i].second));
+    }
+    out += '}';
+}
+
+Fields ResolverFields(const AddrInfoResolver *resolver)
+{
+    return Fields{ { "queued_requests", resolver->GetQueuedRequests() } };
+}
+
+Fields EventLoopFields(const EventLoop *loop)
+{
+    return LoopFields(loop->GetStats());
+}
+
+} // namespace
+
+struct AdminServer::Session
+{
+    std::unique_ptr<Connection> connection;
+    std::string request;
+    bool responded = false;
+    bool finished = false;
+};
+
+AdminServer::AdminServer(const std::string &ip, unsigned short port,
+                         EventLoop *loop)
+    : loop_(loop),
+      acceptor_(ip, port, loop),
+      finished_(0)
+{
+    acceptor_.SetOnNewConnection(
+        [this] (std::unique_ptr<Connection> connection) {
+            HandleNewConnection(std::move(connection));
+        });
+    loop_->AddLoopHandler(this);
+}
+
+AdminServer::~AdminServer()
+{
+    loop_->DelLoopHandler(this);
+}
+
+bool AdminServer::IsListenOk() const
+{
+    return acceptor_.IsListenOk();
+}
+
+void AdminServer::AddLoop(const std::string &name, const EventLoop *loop)
+{
+    loops_.emplace_back(name, loop);
+}
+
+void AdminServer::AddResolver(const std::string &name,
+                              const AddrInfoResolver *resolver)
+{
+    resolvers_.emplace_back(name, resolver);
+}
+
+std::string AdminServer::TextSnapshot() const
+{
+    std::string out;
+    for (auto &loop : loops_)
+        AppendText(out, "loop." + loop.first + ".",
+                   EventLoopFields(loop.second));
+    for (auto &resolver : resolvers_)
+        AppendText(out, "resolver." + resolver.first + ".",
+                   ResolverFields(resolver.second));
+    AppendText(out, "process.", ProcessFields());
+    return out;
+}
+
+std::string AdminServer::JsonSnapshot() const
+{
+    std::string out = "{";
+    AppendJsonSources(out, "loops", loops_, EventLoopFields);
+    out += ',';
+    AppendJsonSources(out, "resolvers", resolvers_, ResolverFields);
+    out += ",\"process\":";
+    AppendJson(out, ProcessFields());
+    out += "}\n";
+    return out;
+}
+
+void AdminServer::HandleLoop()
+{
+    // Sessions are destroyed here instead of in their own callbacks.
+    if (finished_ == 0)
+        return ;
+
+    sessions_.erase(
+        std::remove_if(sessions_.begin(), sessions_.end(),
+                       [] (const std::unique_ptr<Session> &session) {
+                           return session->finished;
+                       }),
+        sessions_.end());
+    finished_ = 0;
+}
+
+void AdminServer::HandleNewConnection(std::unique_ptr<Connection> connection)
+{
+    if (!connection)
+        return ;
+
+    std::unique_ptr<Session> session(new Session);
+    auto s = session.get();
+    s->connection = std::move(connection);
+    s->connection->SetOnError([this, s] () { Finish(s); });
+    s->connection->SetOnReceivable([this, s] () { HandleRecv(s); });
+    s->connection->SetOnSendComplete(
+        [s] () { s->connection->Shutdown(ShutdownT::Write); });
+    sessions_.push_back(std::move(session));
+}
+
+void AdminServer::HandleRecv(Session *session)
+{
+    char buf[512];
+
+    while (!session->finished)
+    {
+        Buffer buffer(buf, sizeof(buf));
+        auto ret = session->connection->Recv(&buffer);
+
+        if (ret == static_cast<int>(RecvE::PeerClosed) ||
+            ret == static_cast<int>(RecvE::Error))
+            return Finish(session);
+
+        if (ret == static_cast<int>(RecvE::NoAvailData))
+            return ;
+
+        // Data after the request is read and dropped until the peer
+        // closes, so the response is not reset by unread data.
+        if (session->responded)
+            continue;
+
+        session->request.append(buf, ret);
+        if (session->request.size() > kMaxRequestSize)
+            return Finish(session);
+
+        Respond(session);
+    }
+}
+
+void AdminServer::Respond(Session *session)
+{
+    auto &request = session->request;
+    bool http = request.compare(0, 4, "GET ") == 0;
+
+    // HTTP request is complete at the end of headers, the others at the
+    // end of the first line.
+    auto end = request.find(http ? "\n\r\n" : "\n");
+    if (end == std::string::npos)
+        end = http ? request.find("\n\n") : end;
+    if (end == std::string::npos)
+        return ;
+
+    std::string target;
+    if (http)
+    {
+        auto space = request.find(' ', 4);
+        target = request.substr(4, space == std::string::npos ?
+                                std::string::npos : space - 4);
+    }
+    else
+    {
+        target = request.substr(0, request.find_first_of("\r\n"));
+    }
+
+    bool json = target == "json" || target == "/json";
+    bool found = json || target == "stats" || target == "/stats";
+
+    std::string body;
+    if (json)
+        body = JsonSnapshot();
+    else if (found)
+        body = TextSnapshot();
+    else
+        body = "unknown request, use stats or json\n";
+
+    std::string response;
+    if (http)
+    {
+        char header[160];
+        snprintf(header, sizeof(header),
+                 "HTTP/1.0 %s\r\nContent-Type: %s\r\n"
+                 "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                 found ? "200 OK" : "404 Not Found",
+                 json ? "application/json" : "text/plain", body.size());
+        response = header;
+    }
+    response += body;
+
+    session->responded = true;
+
+    auto size = response.size();
+    auto buf = new char[size];
+    memcpy(buf, response.data(), size);
+    std::unique_ptr<Buffer> buffer(new Buffer(buf, size, OpDeleter));
+
+    if (session->connection->Send(std::move(buffer)) ==
+        static_cast<int>(SendE::Error))
+        Finish(session);
+}
+
+void AdminServer::Finish(Session *session)
+{
+    if (session->finished)
+        return ;
+
+    session->finished = true;
+    session->connection->Close();
+    ++finished_;
+}
+
+} // namespace snet
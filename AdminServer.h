@@ -0,0 +1,64 @@
+#ifndef ADMIN_SERVER_H
+#define ADMIN_SERVER_H
+
+#include "Acceptor.h"
+#include "Connection.h"
+#include "EventLoop.h"
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace snet
+{
+
+class AddrInfoResolver;
+
+// Serve a snapshot of the stats of snet in the process. A client sends a
+// request line "stats" for plaintext or "json" for JSON, HTTP requests of
+// "GET /stats" and "GET /json" are served too, the connection is shut down
+// after the snapshot is sent. Sources are read through their thread-safe
+// counters, so watched loops are never locked. There is no authentication,
+// listen on a loopback address.
+class AdminServer final : public LoopHandler
+{
+public:
+    AdminServer(const std::string &ip, unsigned short port, EventLoop *loop);
+    ~AdminServer();
+
+    AdminServer(const AdminServer &) = delete;
+    void operator = (const AdminServer &) = delete;
+
+    bool IsListenOk() const;
+
+    // Sources must outlive the server, add them in the thread of loop
+    // or before loop runs.
+    void AddLoop(const std::string &name, const EventLoop *loop);
+    void AddResolver(const std::string &name,
+                     const AddrInfoResolver *resolver);
+
+    std::string TextSnapshot() const;
+    std::string JsonSnapshot() const;
+
+    virtual void HandleLoop() override;
+    virtual void HandleStop() override { }
+
+private:
+    struct Session;
+
+    void HandleNewConnection(std::unique_ptr<Connection> connection);
+    void HandleRecv(Session *session);
+    void Respond(Session *session);
+    void Finish(Session *session);
+
+    EventLoop *loop_;
+    Acceptor acceptor_;
+    std::vector<std::pair<std::string, const EventLoop *>> loops_;
+    std::vector<std::pair<std::string, const AddrInfoResolver *>> resolvers_;
+    std::vector<std::unique_ptr<Session>> sessions_;
+    std::size_t finished_;
+};
+
+} // namespace snet
+
+#endif // ADMIN_SERVER_H
@@ -0,0 +1,251 @@
+#include "Affinity.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+
+// Parse a list of sysfs like "0-3,8-11".
+std::vector<int> ParseList(const char *list)
+{
+    std::vector<int> ids;
+    while (*list)
+    {
+        char *end = nullptr;
+        auto first = strtol(list, &end, 10);
+        if (end == list)
+            break;
+
+        auto last = first;
+        if (*end == '-')
+        {
+            list = end + 1;
+            last = strtol(list, &end, 10);
+            if (end == list)
+                break;
+        }
+
+        for (auto id = first; id <= last; ++id)
+            ids.push_back(static_cast<int>(id));
+
+        list = end;
+        if (*list != ',')
+            break;
+        ++list;
+    }
+    return ids;
+}
+
+bool ReadList(const std::string &path, std::vector<int> *ids)
+{
+    auto file = fopen(path.c_str(), "r");
+    if (!file)
+        return false;
+
+    char line[4096];
+    auto ok = fgets(line, sizeof(line), file) != nullptr;
+    fclose(file);
+
+    if (ok)
+        *ids = ParseList(line);
+    return ok;
+}
+
+} // namespace
+
+namespace snet
+{
+
+int GetCpuCount()
+{
+    auto count = sysconf(_SC_NPROCESSORS_CONF);
+    return count > 0 ? static_cast<int>(count) : 1;
+}
+
+int GetNumaNodeCount()
+{
+    std::vector<int> nodes;
+    if (!ReadList("/sys/devices/system/node/online", &nodes) || nodes.empty())
+        return 1;
+    return nodes.back() + 1;
+}
+
+int GetCpuNumaNode(int cpu)
+{
+    auto count = GetNumaNodeCount();
+    for (int node = 0; node < count; ++node)
+    {
+        auto cpus = GetNumaNodeCpus(node);
+        if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end())
+            return node;
+    }
+    return 0;
+}
+
+std::vector<int> GetNumaNodeCpus(int node)
+{
+    std::vector<int> cpus;
+    auto path = "/sys/devices/system/node/node" + std::to_string(node) +
+        "/cpulist";
+    if (ReadList(path, &cpus) || node != 0)
+        return cpus;
+
+    for (int cpu = 0; cpu < GetCpuCount(); ++cpu)
+        cpus.push_back(cpu);
+    return cpus;
+}
+
+std::vector<int> GetAllowedCpus()
+{
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+        }
+    }
+#endif
+
+    if (cpus.empty())
+    {
+        for (int cpu = 0; cpu < GetCpuCount(); ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+int GetCurrentCpu()
+{
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+bool PinCurrentThread(const std::vector<int> &cpus)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    int count = 0;
+    for (auto cpu : cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+            ++count;
+        }
+    }
+
+    return count > 0 &&
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+bool PinCurrentThreadToCpu(int cpu)
+{
+    return PinCurrentThread(std::vector<int>(1, cpu));
+}
+
+bool PinCurrentThreadToNode(int node)
+{
+    if (!PinCurrentThread(GetNumaNodeCpus(node)))
+        return false;
+
+#if defined(__linux__)
+    if (GetNumaNodeCount() == 1)
+        return true;
+
+    // Node mask of set_mempolicy, maxnode counts one more bit than the
+    // mask like libnuma does.
+    const int kBits = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> mask(node / kBits + 1);
+    mask[node / kBits] |= 1UL << (node % kBits);
+
+    return syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask.data(),
+                   mask.size() * kBits + 1) == 0;
+#else
+    return true;
+#endif
+}
+
+std::size_t CpuLoopMap::Loops::Next()
+{
+    auto loop = loops[next];
+    next = (next + 1) % loops.size();
+    return loop;
+}
+
+CpuLoopMap::CpuLoopMap()
+    : cpu_nodes_(GetCpuCount(), 0),
+      cpu_loops_(cpu_nodes_.size()),
+      node_loops_(GetNumaNodeCount())
+{
+    for (std::size_t node = 0; node < node_loops_.size(); ++node)
+    {
+        for (auto cpu : GetNumaNodeCpus(static_cast<int>(node)))
+        {
+            if (cpu >= 0 && static_cast<std::size_t>(cpu) < cpu_nodes_.size())
+                cpu_nodes_[cpu] = static_cast<int>(node);
+        }
+    }
+}
+
+void CpuLoopMap::AddLoop(std::size_t loop, int cpu)
+{
+    all_loops_.loops.push_back(loop);
+    if (cpu < 0)
+        return ;
+
+    auto index = static_cast<std::size_t>(cpu);
+    if (index >= cpu_nodes_.size())
+    {
+        cpu_nodes_.resize(index + 1, 0);
+        cpu_loops_.resize(index + 1);
+    }
+
+    cpu_loops_[index].loops.push_back(loop);
+    node_loops_[cpu_nodes_[index]].loops.push_back(loop);
+}
+
+bool CpuLoopMap::Empty() const
+{
+    return all_loops_.loops.empty();
+}
+
+std::size_t CpuLoopMap::FindLoop(int cpu)
+{
+    if (cpu >= 0 && static_cast<std::size_t>(cpu) < cpu_nodes_.size())
+    {
+        auto &cpu_loops = cpu_loops_[cpu];
+        if (!cpu_loops.loops.empty())
+            return cpu_loops.Next();
+
+        auto &node_loops = node_loops_[cpu_nodes_[cpu]];
+        if (!node_loops.loops.empty())
+            return node_loops.Next();
+    }
+
+    return all_loops_.Next();
+}
+
+} // namespace snet
@@ -0,0 +1,75 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <cstddef>
+#include <vector>
+
+namespace snet
+{
+
+// CPU and NUMA topology from sysfs. Machines without NUMA information
+// have all CPUs in node 0.
+int GetCpuCount();
+int GetNumaNodeCount();
+int GetCpuNumaNode(int cpu);
+std::vector<int> GetNumaNodeCpus(int node);
+
+// CPUs the current thread is allowed to run on by its affinity mask,
+// which excludes the CPUs outside the cpuset of the process and offline
+// ones. All CPUs when the mask is unknown.
+std::vector<int> GetAllowedCpus();
+
+// CPU running the current thread, -1 when it is unknown.
+int GetCurrentCpu();
+
+// Pin the current thread to cpus, call it at the beginning of a loop
+// thread. Return false when pinning is not supported.
+bool PinCurrentThread(const std::vector<int> &cpus);
+bool PinCurrentThreadToCpu(int cpu);
+
+// Pin the current thread to the CPUs of node and prefer the memory of
+// node for its allocations. Only memory first touched by the thread, like
+// its slab chunks, comes from the node. Objects made by other threads
+// stay where those threads put them, e.g. connections made by Acceptor
+// in the thread of its loop, whichever loop they are handed to later.
+bool PinCurrentThreadToNode(int node);
+
+// Choose the event loop of a connection by the CPU which processed its
+// packets, so softirq, socket memory and the loop stay on one CPU. Loops
+// are identified by indexes and added with the CPUs they are pinned to.
+// A CPU without loops is served by the loops of its NUMA node in turn,
+// then by all loops in turn.
+class CpuLoopMap final
+{
+public:
+    CpuLoopMap();
+
+    CpuLoopMap(const CpuLoopMap &) = delete;
+    void operator = (const CpuLoopMap &) = delete;
+
+    void AddLoop(std::size_t loop, int cpu);
+    bool Empty() const;
+
+    // Loop for cpu, a negative cpu is served by all loops in turn.
+    // The map must not be empty.
+    std::size_t FindLoop(int cpu);
+
+private:
+    struct Loops
+    {
+        std::vector<std::size_t> loops;
+        std::size_t next = 0;
+
+        std::size_t Next();
+    };
+
+    // Indexed by CPU and by NUMA node.
+    std::vector<int> cpu_nodes_;
+    std::vector<Loops> cpu_loops_;
+    std::vector<Loops> node_loops_;
+    Loops all_loops_;
+};
+
+} // namespace snet
+
+#endif // AFFINITY_H
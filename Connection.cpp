@@ -1,59 +1,422 @@
 #include "Connection.h"
+#include "FlightRecorder.h"
+#include "ReadScheduler.h"
+#include "SendQueueBudget.h"
+#include "Slab.h"
 #include <errno.h>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#elif defined(__APPLE__)
+#include <sys/uio.h>
+#endif
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#define SNET_HAVE_ZEROCOPY 1
+#endif
+
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#define SNET_HAVE_TIMESTAMPING 1
+#endif
+
+#if defined(SNET_HAVE_ZEROCOPY) || defined(SNET_HAVE_TIMESTAMPING)
+#include <linux/errqueue.h>
+#endif
+
+namespace
+{
+
+// Bytes queued by the connections of one thread. Only the thread writes
+// it, by a load and a store instead of a read-modify-write, and it is
+// padded to its own cache line, so sends of different threads share
+// nothing. Connections move between threads, so one counter may wrap
+// below zero, only the sum of all of them is meaningful.
+struct ThreadQueuedBytes
+{
+    char padding0[64];
+    std::atomic<std::size_t> bytes;
+    char padding1[64];
+
+    ThreadQueuedBytes() : bytes(0) { }
+
+    void Add(std::size_t n)
+    {
+        bytes.store(bytes.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+    }
+};
+
+// Counters of live threads, counters of exited threads are folded into
+// retired.
+class QueuedBytesRegistry final
+{
+public:
+    QueuedBytesRegistry() : retired_(0) { }
+
+    QueuedBytesRegistry(const QueuedBytesRegistry &) = delete;
+    void operator = (const QueuedBytesRegistry &) = delete;
+
+    static QueuedBytesRegistry & Get()
+    {
+        static QueuedBytesRegistry registry;
+        return registry;
+    }
+
+    ThreadQueuedBytes * Register()
+    {
+        std::unique_ptr<ThreadQueuedBytes> counter(new ThreadQueuedBytes);
+        std::lock_guard<std::mutex> l(mutex_);
+        counters_.push_back(counter.get());
+        return counter.release();
+    }
+
+    void Retire(ThreadQueuedBytes *counter)
+    {
+        {
+            std::lock_guard<std::mutex> l(mutex_);
+            retired_ += counter->bytes.load(std::memory_order_relaxed);
+            counters_.erase(
+                std::find(counters_.begin(), counters_.end(), counter));
+        }
+        delete counter;
+    }
+
+    std::size_t Sum()
+    {
+        std::lock_guard<std::mutex> l(mutex_);
+        auto sum = retired_;
+        for (auto counter : counters_)
+            sum += counter->bytes.load(std::memory_order_relaxed);
+
+        // Counters are not read at one instant, a move between threads
+        // may be seen half done, which looks below zero.
+        auto signed_sum = static_cast<std::ptrdiff_t>(sum);
+        return signed_sum > 0 ? static_cast<std::size_t>(signed_sum) : 0;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<ThreadQueuedBytes *> counters_;
+    std::size_t retired_;
+};
+
+struct ThreadQueuedBytesHolder
+{
+    ThreadQueuedBytes *counter = nullptr;
+
+    ~ThreadQueuedBytesHolder()
+    {
+        if (counter)
+            QueuedBytesRegistry::Get().Retire(counter);
+    }
+};
+
+thread_local ThreadQueuedBytesHolder local_queued_bytes;
+
+ThreadQueuedBytes * LocalQueuedBytes()
+{
+    if (!local_queued_bytes.counter)
+        local_queued_bytes.counter = QueuedBytesRegistry::Get().Register();
+    return local_queued_bytes.counter;
+}
+
+// Writes waiting for their timestamps, the oldest ones are dropped when
+// the kernel does not report them.
+const std::size_t kMaxTimestampWrites = 4096;
+
+#ifdef SNET_HAVE_TIMESTAMPING
+// Keys of sent data count from the first byte written after enabling,
+// instead of the first unacknowledged byte. Since Linux 6.2.
+const int kTimestampingOptIdTcp = 1 << 16;
+
+uint64_t ToNanoseconds(const struct timespec &ts)
+{
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+// Read the notifications in the error queue of fd, zero-copy completions
+// are passed to on_zerocopy(id), timestamps of sent data are passed to
+// on_timestamp(key, kernel_ns).
+template<typename OnZeroCopy, typename OnTimestamp>
+void ReadErrorQueue(int fd, const OnZeroCopy &on_zerocopy,
+                    const OnTimestamp &on_timestamp)
+{
+#if defined(SNET_HAVE_ZEROCOPY) || defined(SNET_HAVE_TIMESTAMPING)
+    while (true)
+    {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+            break;
+
+        struct sock_extended_err *err = nullptr;
+        uint64_t kernel_ns = 0;
+
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+             cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+#ifdef SNET_HAVE_TIMESTAMPING
+            if (cmsg->cmsg_level == SOL_SOCKET &&
+                cmsg->cmsg_type == SCM_TIMESTAMPING)
+            {
+                auto tss = reinterpret_cast<struct scm_timestamping *>(
+                    CMSG_DATA(cmsg));
+                kernel_ns = ToNanoseconds(tss->ts[0]);
+            }
+#endif
+            if ((cmsg->cmsg_level == SOL_IP &&
+                 cmsg->cmsg_type == IP_RECVERR) ||
+                (cmsg->cmsg_level == SOL_IPV6 &&
+                 cmsg->cmsg_type == IPV6_RECVERR))
+                err = reinterpret_cast<struct sock_extended_err *>(
+                    CMSG_DATA(cmsg));
+        }
+
+        if (!err)
+            continue;
+
+#ifdef SNET_HAVE_ZEROCOPY
+        // Notification covers the ids in [ee_info, ee_data].
+        if (err->ee_errno == 0 && err->ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+            on_zerocopy(err->ee_data);
+#endif
+#ifdef SNET_HAVE_TIMESTAMPING
+        // Key is the last byte of the write which is timestamped.
+        if (err->ee_errno == ENOMSG &&
+            err->ee_origin == SO_EE_ORIGIN_TIMESTAMPING && kernel_ns > 0)
+            on_timestamp(err->ee_data, kernel_ns);
+#endif
+    }
+#else
+    (void)fd;
+    (void)on_zerocopy;
+    (void)on_timestamp;
+#endif
+}
+
+uint64_t SystemNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
 
 namespace snet
 {
 
+using ConnectionSlab = Slab<sizeof(Connection), alignof(Connection)>;
+
+// Keep the socket and the zero-copy buffers of a closed connection until
+// the kernel completes the buffers, then close the socket and delete
+// itself. Completions missing after kTimeout do not keep the socket, the
+// buffers are freed when the socket has nothing left to send, otherwise
+// leaked instead of freed under the kernel. Lingers left when the loop is
+// destroyed leak their buffers too.
+class Connection::ZeroCopyLinger final : public EventHandler,
+                                         public LoopHandler
+{
+public:
+    static const int kTimeout = 10;
+
+    ZeroCopyLinger(int fd, EventLoop *loop, SendList *list,
+                   uint32_t completed)
+        : fd_(fd),
+          loop_(loop),
+          list_(*list),
+          completed_(completed),
+          deadline_(std::chrono::steady_clock::now() +
+                    std::chrono::seconds(kTimeout))
+    {
+        *list = SendList();
+
+        // Peer sees the end of the stream after the data, as by close.
+        shutdown(fd_, SHUT_WR);
+        loop_->AddEventHandler(this);
+        loop_->AddLoopHandler(this);
+    }
+
+    ~ZeroCopyLinger()
+    {
+        list_.Clear();
+        close(fd_);
+    }
+
+    ZeroCopyLinger(const ZeroCopyLinger &) = delete;
+    void operator = (const ZeroCopyLinger &) = delete;
+
+    virtual int Fd() const override
+    {
+        return fd_;
+    }
+
+    // Completions are reported by EPOLLERR without any event enabled.
+    virtual Event Events() const override
+    {
+        return static_cast<Event>(0);
+    }
+
+    virtual Event EnabledEvents() const override
+    {
+        return static_cast<Event>(0);
+    }
+
+    virtual void HandleRead() override { }
+    virtual void HandleWrite() override { }
+
+    virtual void HandleError() override
+    {
+        ::ReadErrorQueue(
+            fd_,
+            [this] (uint32_t id) {
+                if (!SendList::IdBefore(id, completed_))
+                    completed_ = id + 1;
+            },
+            [] (uint32_t, uint64_t) { });
+
+        list_.Complete(completed_);
+        if (list_.Empty())
+            Finish();
+    }
+
+    virtual void HandleLoop() override
+    {
+        if (std::chrono::steady_clock::now() < deadline_)
+            return ;
+
+        if (UnsentBytes() != 0)
+        {
+            while (!list_.Empty())
+            {
+                auto item = list_.Pop();
+                item->buffer.release();
+                delete item;
+            }
+        }
+
+        Finish();
+    }
+
+    virtual void HandleStop() override { }
+
+private:
+    int UnsentBytes() const
+    {
+        int unsent = -1;
+#ifdef SNET_HAVE_ZEROCOPY
+        if (ioctl(fd_, SIOCOUTQ, &unsent) < 0)
+            unsent = -1;
+#endif
+        return unsent;
+    }
+
+    void Finish()
+    {
+        loop_->DelEventHandler(this);
+        loop_->DelLoopHandler(this);
+        delete this;
+    }
+
+    int fd_;
+    EventLoop *loop_;
+    SendList list_;
+    uint32_t completed_;
+    std::chrono::steady_clock::time_point deadline_;
+};
+
+std::size_t GetTotalQueuedSendBytes()
+{
+    return QueuedBytesRegistry::Get().Sum();
+}
+
 Connection::Connection(int fd, EventLoop *loop)
-    : fd_(fd),
+    : EventHandler(kHandlerTag),
+      enabled_events_(static_cast<unsigned char>(Event::Read)),
+      read_holds_(0),
+      fd_(fd),
       loop_(loop),
-      eh_(this)
+      send_queue_bytes_(0)
 {
     if (loop_)
-        loop_->AddEventHandler(&eh_);
+        loop_->AddEventHandler(this);
 }
 
 Connection::~Connection()
 {
+    ResetBackpressure();
     Close();
+
+    if (ext_ && ext_->send_queue_budget)
+        ext_->send_queue_budget->DelConnection(this);
 }
 
-int Connection::Send(std::unique_ptr<Buffer> buffer)
+void * Connection::operator new (std::size_t size)
 {
-    if (!send_queue_.empty())
-    {
-        send_queue_.push(std::move(buffer));
-        return static_cast<int>(SendE::OK);
-    }
+    auto ptr = ConnectionSlab::Allocate();
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
 
-    auto ret = WriteBuffer(buffer);
-    if (ret == static_cast<int>(SendE::Error))
-        return ret;
+void Connection::operator delete (void *ptr)
+{
+    if (ptr)
+        ConnectionSlab::Free(ptr);
+}
 
-    if (buffer->pos == buffer->size)
-    {
-        if (on_send_complete_)
-            on_send_complete_();
-        return ret;
-    }
+int Connection::Send(std::unique_ptr<Buffer> buffer)
+{
+    SendItem item;
+    item.buffer = std::move(buffer);
+    return QueueSendItem(std::move(item));
+}
 
-    send_queue_.push(std::move(buffer));
+int Connection::SendFile(int fd, off_t offset, std::size_t length)
+{
+    auto file_fd = dup(fd);
+    if (file_fd < 0)
+        return static_cast<int>(SendE::Error);
 
-    eh_.EnableWrite();
-    loop_->UpdateEvents(&eh_);
-    return ret;
+    SendItem item;
+    item.file.reset(new FileSegment(file_fd, offset, length));
+    return QueueSendItem(std::move(item));
 }
 
 int Connection::Recv(Buffer *buffer)
 {
     auto buf = buffer->buf + buffer->pos;
     auto len = buffer->size - buffer->pos;
-    auto bytes = recv(fd_, buf, len, 0);
+
+    if (ext_ && ext_->read_scheduler)
+    {
+        auto budget = ReadBudget();
+        if (budget == 0)
+            return static_cast<int>(RecvE::NoAvailData);
+        len = std::min(len, budget);
+    }
+
+    auto bytes = ext_ && ext_->timestamping ?
+        RecvTimestamped(buf, len) : recv(fd_, buf, len, 0);
 
     if (bytes == 0)
     {
-        eh_.DisableRead();
-        loop_->UpdateEvents(&eh_);
+        HoldRead(kReadHoldPeerClosed);
         return static_cast<int>(RecvE::PeerClosed);
     }
 
@@ -62,18 +425,38 @@ int Connection::Recv(Buffer *buffer)
 
     if (bytes < 0)
         return static_cast<int>(RecvE::NoAvailData);
+
+    SNET_TRACE(BytesReceived, fd_, bytes);
+
+    if (ext_ && ext_->read_scheduler)
+        ChargeRead(bytes);
+    if (ext_ && ext_->stats_enabled)
+        CountReceived(bytes);
     return bytes;
 }
 
 void Connection::Close()
 {
+    // Queued data is never sent after close.
+    DropSendQueue();
+
     if (fd_ >= 0)
     {
+        SNET_TRACE(ConnectionClosed, fd_, 0);
+
         if (loop_)
-            loop_->DelEventHandler(&eh_);
-        close(fd_);
+            loop_->DelEventHandler(this);
+
+        // Kernel may still send from the buffers sent by zero-copy.
+        if (HasZeroCopyPending())
+            LingerZeroCopy();
+        else
+            close(fd_);
         fd_ = -1;
     }
+
+    if (ext_)
+        CancelParkedRead();
 }
 
 void Connection::SetTcpKeepAlive()
@@ -111,36 +494,438 @@ bool Connection::GetPeerAddress(struct sockaddr_in *inet)
                        &size) == 0;
 }
 
-void Connection::SetOnError(const OnError &oe)
+bool Connection::GetTcpInfo(TcpInfo *info) const
+{
+    return GetSocketTcpInfo(fd_, info);
+}
+
+int Connection::GetIncomingCpu() const
+{
+    return GetSocketIncomingCpu(fd_);
+}
+
+void Connection::EnableStats()
+{
+    auto &ext = Ext();
+    if (ext.stats_enabled)
+        return ;
+
+    ext.stats_enabled = true;
+    ext.stats.send_queue_peak = send_queue_bytes_;
+
+    // Blocked time is counted from now when the send queue is not empty.
+    if (send_queue_bytes_ > 0)
+        ext.send_queue_since = std::chrono::steady_clock::now();
+}
+
+ConnectionStats Connection::GetStats() const
+{
+    if (ext_ && ext_->stats_enabled)
+        return ext_->stats;
+    return ConnectionStats();
+}
+
+bool Connection::EnableTimestamping()
+{
+#ifdef SNET_HAVE_TIMESTAMPING
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE |
+        SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+        SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    int with_id_tcp = flags | kTimestampingOptIdTcp;
+
+    // Older kernels count keys from the first unacknowledged byte, which
+    // is behind the next written byte by the bytes in the send buffer.
+    int unsent = 0;
+    if (setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPING,
+                   &with_id_tcp, sizeof(with_id_tcp)) < 0)
+    {
+        if (setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPING,
+                       &flags, sizeof(flags)) < 0 ||
+            ioctl(fd_, SIOCOUTQ, &unsent) < 0)
+            return false;
+    }
+
+    auto &ext = Ext();
+    ext.timestamping = true;
+    ext.timestamp_bytes = 0;
+    ext.timestamp_base = unsent;
+    ext.timestamp_writes.clear();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Connection::GetRecvTimestamp(RecvTimestamp *timestamp) const
+{
+    if (!ext_ || ext_->recv_timestamp.kernel_ns == 0)
+        return false;
+
+    *timestamp = ext_->recv_timestamp;
+    return true;
+}
+
+void Connection::SetOnSendTimestamp(OnSendTimestamp ost)
+{
+    Ext().on_send_timestamp = std::move(ost);
+}
+
+void Connection::SetOnError(OnError oe)
+{
+    on_error_ = std::move(oe);
+}
+
+void Connection::SetOnReceivable(OnReceivable onr)
+{
+    on_recv_ = std::move(onr);
+}
+
+void Connection::SetOnSendComplete(OnSendComplete osc)
+{
+    Ext().on_send_complete = std::move(osc);
+}
+
+void Connection::PauseRead()
 {
-    on_error_ = oe;
+    HoldRead(kReadHoldUser);
 }
 
-void Connection::SetOnReceivable(const OnReceivable &onr)
+void Connection::ResumeRead()
 {
-    on_recv_ = onr;
+    ReleaseRead(kReadHoldUser);
 }
 
-void Connection::SetOnSendComplete(const OnSendComplete &osc)
+void Connection::WaitWritable()
 {
-    on_send_complete_ = osc;
+    EnableEvent(Event::Write);
+    UpdateEvents();
+}
+
+void Connection::SetSendWatermarks(std::size_t low, std::size_t high)
+{
+    auto &ext = Ext();
+    ext.low_watermark = low;
+    ext.high_watermark = high;
+}
+
+void Connection::SetOnHighWatermark(OnHighWatermark ohw)
+{
+    Ext().on_high_watermark = std::move(ohw);
+}
+
+void Connection::SetOnLowWatermark(OnLowWatermark olw)
+{
+    Ext().on_low_watermark = std::move(olw);
+}
+
+void Connection::SetBackpressureSource(Connection *source)
+{
+    auto &ext = Ext();
+
+    if (ext.backpressure_source)
+    {
+        if (ext.above_high_watermark)
+            ext.backpressure_source->ReleaseRead(kReadHoldBackpressure);
+        ext.backpressure_source->ext_->backpressure_sink = nullptr;
+    }
+
+    if (source)
+    {
+        // Previous connection backed by source loses it.
+        auto sink = source->Ext().backpressure_sink;
+        if (sink && sink != this)
+            sink->SetBackpressureSource(nullptr);
+        source->ext_->backpressure_sink = this;
+    }
+
+    ext.backpressure_source = source;
+
+    if (ext.above_high_watermark && ext.backpressure_source)
+        ext.backpressure_source->HoldRead(kReadHoldBackpressure);
+}
+
+std::size_t Connection::GetQueuedSendBytes() const
+{
+    return send_queue_bytes_;
+}
+
+std::chrono::steady_clock::time_point Connection::GetOldestUnsentTime() const
+{
+    if (send_list_.Empty())
+        return std::chrono::steady_clock::time_point();
+    return send_list_.head->queued_time;
+}
+
+void Connection::SetSendQueueBudget(SendQueueBudget *budget)
+{
+    auto &ext = Ext();
+
+    if (ext.send_queue_budget)
+        ext.send_queue_budget->DelConnection(this);
+
+    ext.send_queue_budget = budget;
+
+    if (ext.send_queue_budget)
+    {
+        // Queued time is only tracked for connections under budget, the
+        // items queued before count from now.
+        auto now = std::chrono::steady_clock::now();
+        for (auto item = send_list_.head; item; item = item->next)
+        {
+            if (item->queued_time == std::chrono::steady_clock::time_point())
+                item->queued_time = now;
+        }
+
+        ext.send_queue_budget->AddConnection(this);
+    }
+}
+
+void Connection::SetReadScheduler(ReadScheduler *scheduler, int group)
+{
+    auto &ext = Ext();
+
+    if (ext.read_parked)
+    {
+        CancelParkedRead();
+        if (!IsReadHeld())
+        {
+            EnableEvent(Event::Read);
+            UpdateEvents();
+        }
+    }
+
+    ext.read_scheduler = scheduler;
+    ext.read_group = scheduler && scheduler->HasGroup(group) ? group : 0;
+    ext.read_round = 0;
+}
+
+bool Connection::EnableZeroCopy(std::size_t threshold)
+{
+#ifdef SNET_HAVE_ZEROCOPY
+    int zerocopy = 1;
+    if (setsockopt(fd_, SOL_SOCKET, SO_ZEROCOPY,
+                   &zerocopy, sizeof(zerocopy)) < 0)
+        return false;
+
+    Ext().zerocopy_threshold = threshold > 0 ? threshold : 1;
+    return true;
+#else
+    return false;
+#endif
 }
 
 void Connection::ChangeEventLoop(EventLoop *loop)
 {
-    if (loop_)
-        loop_->DelEventHandler(&eh_);
+    Detach();
+    Attach(loop);
+}
 
+void Connection::Detach()
+{
+    // Scheduler and budget belong to the previous loop.
+    if (ext_ && ext_->read_scheduler)
+    {
+        if (ext_->read_parked)
+        {
+            CancelParkedRead();
+            if (!IsReadHeld())
+                EnableEvent(Event::Read);
+        }
+
+        ext_->read_scheduler = nullptr;
+    }
+
+    if (ext_ && ext_->send_queue_budget)
+    {
+        ext_->send_queue_budget->DelConnection(this);
+        ext_->send_queue_budget = nullptr;
+    }
+
+    // Connections paired by backpressure stay in this thread.
+    ResetBackpressure();
+
+    if (loop_ && fd_ >= 0)
+        loop_->DelEventHandler(this);
+
+    loop_ = nullptr;
+}
+
+void Connection::Attach(EventLoop *loop, ReadScheduler *scheduler,
+                        SendQueueBudget *budget)
+{
     loop_ = loop;
 
+    // Events are level-triggered, so readiness arrived while detached,
+    // and the write event of a pending send queue, are reported again.
+    if (loop_ && fd_ >= 0)
+        loop_->AddEventHandler(this);
+
+    if (scheduler)
+        SetReadScheduler(scheduler, ext_ ? ext_->read_group : 0);
+    if (budget)
+        SetSendQueueBudget(budget);
+}
+
+void Connection::ResetBackpressure()
+{
+    if (!ext_)
+        return ;
+
+    if (ext_->backpressure_source)
+        SetBackpressureSource(nullptr);
+    if (ext_->backpressure_sink)
+        ext_->backpressure_sink->SetBackpressureSource(nullptr);
+}
+
+Connection::Extension & Connection::Ext()
+{
+    if (!ext_)
+        ext_.reset(new Extension);
+    return *ext_;
+}
+
+void Connection::EnableEvent(Event event)
+{
+    enabled_events_ |= static_cast<unsigned char>(event);
+}
+
+void Connection::DisableEvent(Event event)
+{
+    enabled_events_ &= ~static_cast<unsigned char>(event);
+}
+
+void Connection::UpdateEvents()
+{
     if (loop_)
-        loop_->AddEventHandler(&eh_);
+        loop_->UpdateEvents(this);
+}
+
+void Connection::HoldRead(unsigned char hold)
+{
+    read_holds_ |= hold;
+
+    CancelParkedRead();
+    DisableEvent(Event::Read);
+    UpdateEvents();
+}
+
+void Connection::ReleaseRead(unsigned char hold)
+{
+    if (!(read_holds_ & hold))
+        return ;
+
+    read_holds_ &= ~hold;
+    if (IsReadHeld())
+        return ;
+
+    // Budget of the read scheduler is checked again by the next Recv.
+    CancelParkedRead();
+    EnableEvent(Event::Read);
+    UpdateEvents();
+}
+
+bool Connection::IsReadHeld() const
+{
+    return read_holds_ != 0;
+}
+
+int Connection::QueueSendItem(SendItem item)
+{
+    if (ext_ && ext_->stats_enabled)
+    {
+        ++ext_->stats.messages_sent;
+        if (loop_)
+            loop_->Counters().messages_sent.Add(1);
+    }
+
+    if (!send_list_.Empty())
+    {
+        PushSendItem(std::move(item));
+        CheckHighWatermark();
+        return static_cast<int>(SendE::OK);
+    }
+
+    // Send queue is empty, try to send it directly, the node is only
+    // allocated when the item can not be sent at once.
+    auto ret = WriteItem(item);
+    if (ret == static_cast<int>(SendE::Error))
+        return ret;
+
+    if (item.Remain() == 0)
+    {
+        if (item.zerocopy)
+            ReleaseItem(new SendItem(std::move(item)));
+
+        // Zero-copy sends complete when the kernel completes them.
+        if (!HasZeroCopyPending())
+            CallSendComplete();
+        return ret;
+    }
+
+    PushSendItem(std::move(item));
+
+    EnableEvent(Event::Write);
+    UpdateEvents();
+
+    CheckHighWatermark();
+    return ret;
+}
+
+void Connection::PushSendItem(SendItem item)
+{
+    if (ext_ && ext_->send_queue_budget)
+        item.queued_time = std::chrono::steady_clock::now();
+
+    AddQueuedBytes(item.Remain());
+    send_list_.Push(new SendItem(std::move(item)));
 }
 
-int Connection::WriteBuffer(const std::unique_ptr<Buffer> &buffer)
+int Connection::WriteItem(SendItem &item)
 {
+    // Time of the write is taken before it, the kernel may send the data
+    // and timestamp it before the write returns.
+    auto remain = item.Remain();
+    auto send_ns = ext_ && ext_->timestamping ? SystemNanoseconds() : 0;
+    auto ret = item.buffer ? WriteBuffer(item) : WriteFile(item.file);
+
+    if (ext_ && ext_->stats_enabled)
+        CountSent(remain - item.Remain());
+    if (ext_ && ext_->timestamping && remain > item.Remain())
+        RecordWrite(remain - item.Remain(), send_ns);
+    return ret;
+}
+
+int Connection::WriteBuffer(SendItem &item)
+{
+    auto &buffer = item.buffer;
     auto buf = buffer->buf + buffer->pos;
     auto len = buffer->size - buffer->pos;
+#ifdef SNET_HAVE_ZEROCOPY
+    if (ext_ && ext_->zerocopy_threshold > 0 &&
+        len >= ext_->zerocopy_threshold)
+    {
+        auto bytes = send(fd_, buf, len, MSG_ZEROCOPY);
+        if (bytes > 0)
+        {
+            // Every successful zero-copy send consumes one completion id.
+            item.zerocopy = true;
+            item.zerocopy_id = ext_->zerocopy_next_id++;
+
+            SNET_TRACE(BytesSent, fd_, bytes);
+            buffer->pos += bytes;
+            return static_cast<int>(SendE::OK);
+        }
+
+        // ENOBUFS means out of optmem for zero-copy, copy it instead.
+        if (bytes < 0 && errno != ENOBUFS)
+        {
+            if (errno != EAGAIN && errno != EINTR)
+                return static_cast<int>(SendE::Error);
+            return static_cast<int>(SendE::OK);
+        }
+    }
+#endif
+
     auto bytes = send(fd_, buf, len, 0);
 
     if (bytes < 0 && errno != EAGAIN && errno != EINTR)
@@ -149,45 +934,417 @@ int Connection::WriteBuffer(const std::unique_ptr<Buffer> &buffer)
     if (bytes < 0)
         bytes = 0;
 
+    SNET_TRACE(BytesSent, fd_, bytes);
     buffer->pos += bytes;
     return static_cast<int>(SendE::OK);
 }
 
-void Connection::HandleRead()
+int Connection::WriteFile(const std::unique_ptr<FileSegment> &file)
+{
+    auto offset = file->offset + static_cast<off_t>(file->pos);
+    auto len = file->size - file->pos;
+    if (len == 0)
+        return static_cast<int>(SendE::OK);
+
+#if defined(__linux__)
+    auto bytes = sendfile(fd_, file->fd, &offset, len);
+
+    // File is shorter than the segment.
+    if (bytes == 0)
+        return static_cast<int>(SendE::Error);
+
+    if (bytes < 0 && errno != EAGAIN && errno != EINTR)
+        return static_cast<int>(SendE::Error);
+
+    if (bytes < 0)
+        bytes = 0;
+#elif defined(__APPLE__)
+    off_t bytes = len;
+    auto ret = sendfile(file->fd, fd_, offset, &bytes, nullptr, 0);
+
+    // Partial data may be sent when it fails with EAGAIN.
+    if (ret < 0 && errno != EAGAIN && errno != EINTR)
+        return static_cast<int>(SendE::Error);
+
+    // File is shorter than the segment.
+    if (ret == 0 && bytes == 0)
+        return static_cast<int>(SendE::Error);
+#else
+#error "Platform is not support"
+#endif
+
+    SNET_TRACE(BytesSent, fd_, bytes);
+    file->pos += bytes;
+    return static_cast<int>(SendE::OK);
+}
+
+void Connection::AddQueuedBytes(std::size_t bytes)
 {
-    on_recv_();
+    if (send_queue_bytes_ == 0 && ext_ && ext_->stats_enabled)
+        ext_->send_queue_since = std::chrono::steady_clock::now();
+
+    send_queue_bytes_ += bytes;
+    LocalQueuedBytes()->Add(bytes);
+
+    if (ext_ && ext_->stats_enabled &&
+        send_queue_bytes_ > ext_->stats.send_queue_peak)
+        ext_->stats.send_queue_peak = send_queue_bytes_;
+}
+
+void Connection::SubQueuedBytes(std::size_t bytes)
+{
+    send_queue_bytes_ -= bytes;
+    LocalQueuedBytes()->Add(0 - bytes);
+
+    if (send_queue_bytes_ == 0 && bytes > 0 && ext_ && ext_->stats_enabled)
+        CountSendBlocked();
+}
+
+void Connection::DropSendQueue()
+{
+    while (!send_list_.Empty())
+    {
+        auto item = send_list_.Pop();
+        SubQueuedBytes(item->Remain());
+        ReleaseItem(item);
+    }
+
+    // Source is no longer held back by the dropped bytes. OnLowWatermark
+    // is not called, the stream is broken and it may be the destructor.
+    if (ext_ && ext_->above_high_watermark)
+    {
+        ext_->above_high_watermark = false;
+        if (ext_->backpressure_source)
+            ext_->backpressure_source->ReleaseRead(kReadHoldBackpressure);
+    }
+}
+
+bool Connection::HasZeroCopyPending() const
+{
+    return ext_ && !ext_->zerocopy_list.Empty();
+}
+
+void Connection::LingerZeroCopy()
+{
+    if (loop_)
+    {
+        new ZeroCopyLinger(fd_, loop_, &ext_->zerocopy_list,
+                           ext_->zerocopy_completed);
+        return ;
+    }
+
+    // Detached connection has no loop to wait for the completions in,
+    // leak the buffers instead of freeing them under the kernel.
+    auto &list = ext_->zerocopy_list;
+    while (!list.Empty())
+    {
+        auto item = list.Pop();
+        item->buffer.release();
+        delete item;
+    }
+
+    close(fd_);
+}
+
+void Connection::ReleaseItem(SendItem *item)
+{
+    // Kernel may still reference the buffer sent by zero-copy, keep it
+    // until the completion, which may have arrived while it was queued.
+    if (item->zerocopy &&
+        !SendList::IdBefore(item->zerocopy_id, ext_->zerocopy_completed))
+        ext_->zerocopy_list.Push(item);
+    else
+        delete item;
+}
+
+void Connection::ReadErrorQueue()
+{
+    ::ReadErrorQueue(
+        fd_,
+        [this] (uint32_t id) { CompleteZeroCopy(id); },
+        [this] (uint32_t key, uint64_t kernel_ns) {
+            CompleteTimestamp(key, kernel_ns);
+        });
+}
+
+void Connection::CompleteZeroCopy(uint32_t id)
+{
+    // Notification covers the ids up to id, which may belong to items
+    // still in the send queue whose tails are sent by copy.
+    if (!SendList::IdBefore(id, ext_->zerocopy_completed))
+        ext_->zerocopy_completed = id + 1;
+    ext_->zerocopy_list.Complete(ext_->zerocopy_completed);
+}
+
+ssize_t Connection::RecvTimestamped(char *buf, std::size_t len)
+{
+#ifdef SNET_HAVE_TIMESTAMPING
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = len;
+
+    char control[128];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    auto bytes = recvmsg(fd_, &msg, 0);
+    if (bytes <= 0)
+        return bytes;
+
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET ||
+            cmsg->cmsg_type != SCM_TIMESTAMPING)
+            continue;
+
+        auto tss = reinterpret_cast<struct scm_timestamping *>(
+            CMSG_DATA(cmsg));
+        if (tss->ts[0].tv_sec == 0 && tss->ts[0].tv_nsec == 0)
+            continue;
+
+        ext_->recv_timestamp.kernel_ns = ToNanoseconds(tss->ts[0]);
+        ext_->recv_timestamp.read_ns = SystemNanoseconds();
+    }
+
+    return bytes;
+#else
+    return recv(fd_, buf, len, 0);
+#endif
+}
+
+void Connection::RecordWrite(std::size_t bytes, uint64_t send_ns)
+{
+    auto &ext = *ext_;
+    ext.timestamp_bytes += bytes;
+
+    if (ext.timestamp_writes.size() == kMaxTimestampWrites)
+        ext.timestamp_writes.pop_front();
+    ext.timestamp_writes.emplace_back(ext.timestamp_bytes, send_ns);
+}
+
+void Connection::CompleteTimestamp(uint32_t key, uint64_t kernel_ns)
+{
+    // Keys are the low 32 bits of byte offsets, writes are timestamped
+    // in order, and writes split by the kernel report more keys.
+    auto &writes = ext_->timestamp_writes;
+    while (!writes.empty())
+    {
+        auto write = writes.front();
+        auto last = static_cast<uint32_t>(
+            ext_->timestamp_base + write.first - 1);
+        auto ahead = static_cast<int32_t>(last - key);
+        if (ahead > 0)
+            break;
+
+        writes.pop_front();
+        if (ahead == 0 && ext_->on_send_timestamp)
+        {
+            SendTimestamp timestamp;
+            timestamp.bytes = write.first;
+            timestamp.send_ns = write.second;
+            timestamp.kernel_ns = kernel_ns;
+            ext_->on_send_timestamp(timestamp);
+        }
+    }
+}
+
+void Connection::CheckHighWatermark()
+{
+    if (!ext_ || ext_->high_watermark == 0 || ext_->above_high_watermark)
+        return ;
+
+    if (send_queue_bytes_ >= ext_->high_watermark)
+    {
+        ext_->above_high_watermark = true;
+
+        if (ext_->backpressure_source)
+            ext_->backpressure_source->HoldRead(kReadHoldBackpressure);
+        if (ext_->on_high_watermark)
+            ext_->on_high_watermark();
+    }
+}
+
+void Connection::CheckLowWatermark()
+{
+    if (!ext_ || !ext_->above_high_watermark)
+        return ;
+
+    if (send_queue_bytes_ <= ext_->low_watermark)
+    {
+        ext_->above_high_watermark = false;
+
+        if (ext_->backpressure_source)
+            ext_->backpressure_source->ReleaseRead(kReadHoldBackpressure);
+        if (ext_->on_low_watermark)
+            ext_->on_low_watermark();
+    }
+}
+
+void Connection::CallSendComplete()
+{
+    if (ext_ && ext_->on_send_complete)
+        ext_->on_send_complete();
+}
+
+void Connection::HandleError()
+{
+    // Only the error queue of zero-copy and timestamping is read here,
+    // socket errors are left to Recv and Send, which report them once.
+    if (!ext_ || (ext_->zerocopy_threshold == 0 && !ext_->timestamping))
+        return ;
+
+    auto pending = HasZeroCopyPending();
+    ReadErrorQueue();
+
+    if (pending && !HasZeroCopyPending() && send_list_.Empty())
+        CallSendComplete();
+}
+
+void Connection::HandleEvict()
+{
+    ext_->send_queue_budget->DelConnection(this);
+    ext_->send_queue_budget = nullptr;
+
+    // Queued bytes and the backpressure they hold are released by Close
+    // even when OnError does not close it, the stream is broken anyway.
+    Close();
+
+    if (on_error_)
+        on_error_();
 }
 
 void Connection::HandleWrite()
 {
-    while (!send_queue_.empty())
+    while (!send_list_.Empty())
     {
-        auto &buffer = send_queue_.front();
-        auto ret = WriteBuffer(buffer);
+        auto item = send_list_.head;
+        auto remain = item->Remain();
+        auto ret = WriteItem(*item);
+        SubQueuedBytes(remain - item->Remain());
 
         if (ret == static_cast<int>(SendE::Error))
         {
-            eh_.DisableWrite();
-            loop_->UpdateEvents(&eh_);
+            DisableEvent(Event::Write);
+            UpdateEvents();
 
-            on_error_();
-            break;
+            if (on_error_)
+                on_error_();
+            return ;
         }
 
-        if (buffer->pos < buffer->size)
+        if (item->Remain() > 0)
             break;
 
-        send_queue_.pop();
+        ReleaseItem(send_list_.Pop());
     }
 
-    if (send_queue_.empty())
+    CheckLowWatermark();
+
+    if (send_list_.Empty())
     {
-        eh_.DisableWrite();
-        loop_->UpdateEvents(&eh_);
+        DisableEvent(Event::Write);
+        UpdateEvents();
 
-        if (on_send_complete_)
-            on_send_complete_();
+        if (!HasZeroCopyPending())
+            CallSendComplete();
     }
 }
 
+void Connection::CountSent(std::size_t bytes)
+{
+    ext_->stats.bytes_sent += bytes;
+    if (loop_)
+        loop_->Counters().bytes_sent.Add(bytes);
+}
+
+void Connection::CountReceived(std::size_t bytes)
+{
+    ++ext_->stats.messages_received;
+    ext_->stats.bytes_received += bytes;
+    if (loop_)
+    {
+        auto &counters = loop_->Counters();
+        counters.messages_received.Add(1);
+        counters.bytes_received.Add(bytes);
+    }
+}
+
+void Connection::CountSendBlocked()
+{
+    auto blocked = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - ext_->send_queue_since).count();
+
+    ext_->stats.send_blocked_ns += blocked;
+    if (loop_)
+        loop_->Counters().send_blocked_ns.Add(blocked);
+}
+
+std::size_t Connection::ReadBudget()
+{
+    auto &ext = *ext_;
+    auto scheduler = ext.read_scheduler;
+
+    // Used budgets are reset when a new round begins.
+    if (ext.read_round != scheduler->Round())
+    {
+        ext.read_round = scheduler->Round();
+        ext.read_bytes = 0;
+        ext.read_messages = 0;
+    }
+
+    auto bytes = scheduler->ByteBudget(ext.read_group);
+    auto messages = scheduler->MessageBudget(ext.read_group);
+
+    if ((bytes > 0 && ext.read_bytes >= bytes) ||
+        (messages > 0 && ext.read_messages >= messages))
+    {
+        // Stop reading events until the scheduler resumes it, the update
+        // is dropped when it is resumed before next wait.
+        if (!ext.read_parked)
+        {
+            ext.read_parked = true;
+            DisableEvent(Event::Read);
+            UpdateEvents();
+            ext.read_park_slot = scheduler->Park(this);
+        }
+
+        return 0;
+    }
+
+    if (bytes == 0)
+        return std::numeric_limits<std::size_t>::max();
+    return bytes - ext.read_bytes;
+}
+
+void Connection::ChargeRead(std::size_t bytes)
+{
+    ext_->read_bytes += bytes;
+    ++ext_->read_messages;
+}
+
+void Connection::CancelParkedRead()
+{
+    if (ext_ && ext_->read_parked)
+    {
+        ext_->read_parked = false;
+        ext_->read_scheduler->Unpark(this, ext_->read_park_slot);
+    }
+}
+
+void Connection::ResumeParkedRead()
+{
+    ext_->read_parked = false;
+    if (IsReadHeld())
+        return ;
+
+    EnableEvent(Event::Read);
+    UpdateEvents();
+    HandleRead();
+}
+
 } // namespace snet
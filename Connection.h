@@ -2,11 +2,14 @@
 #define CONNECTION_H
 
 #include "Buffer.h"
+#include "Delegate.h"
 #include "EventLoop.h"
 #include "SocketOps.h"
-#include <functional>
+#include <chrono>
+#include <deque>
 #include <memory>
-#include <queue>
+#include <stdint.h>
+#include <utility>
 
 namespace snet
 {
@@ -31,12 +34,57 @@ enum class ShutdownT
     Both
 };
 
-class Connection final
+class ReadScheduler;
+class SendQueueBudget;
+
+// Traffic counters of a connection.
+struct ConnectionStats
+{
+    uint64_t bytes_sent = 0;
+    uint64_t bytes_received = 0;
+    // Buffers and file segments queued by Send and SendFile.
+    uint64_t messages_sent = 0;
+    // Recv calls which returned data.
+    uint64_t messages_received = 0;
+    std::size_t send_queue_peak = 0;
+    // Time the send queue waited for the socket to be writable.
+    uint64_t send_blocked_ns = 0;
+};
+
+// Timestamps are nanoseconds of the system clock. Received data arrived
+// in the kernel at kernel_ns and was read by Recv at read_ns.
+struct RecvTimestamp
+{
+    uint64_t kernel_ns = 0;
+    uint64_t read_ns = 0;
+};
+
+// Sent data up to the bytes-th byte since timestamping was enabled was
+// written to the socket at send_ns and left the socket at kernel_ns.
+struct SendTimestamp
+{
+    uint64_t bytes = 0;
+    uint64_t send_ns = 0;
+    uint64_t kernel_ns = 0;
+};
+
+// Bytes queued in send queues of all connections in the process. Sends
+// only touch a counter of their thread, this sums the counters of all
+// threads under a lock, so it is for periodic checks and stats.
+std::size_t GetTotalQueuedSendBytes();
+
+// Connection is the event handler of itself, and the rarely used states
+// are allocated when they are used first time, so an idle connection
+// only keeps fd, callbacks and an empty intrusive send queue.
+class Connection final : private EventHandler
 {
 public:
-    using OnSendComplete = std::function<void ()>;
-    using OnReceivable = std::function<void ()>;
-    using OnError = std::function<void ()>;
+    using OnSendComplete = Delegate<void ()>;
+    using OnReceivable = Delegate<void ()>;
+    using OnError = Delegate<void ()>;
+    using OnHighWatermark = Delegate<void ()>;
+    using OnLowWatermark = Delegate<void ()>;
+    using OnSendTimestamp = Delegate<void (const SendTimestamp &)>;
 
     Connection(int fd, EventLoop *loop);
     ~Connection();
@@ -44,7 +92,17 @@ public:
     Connection(const Connection &) = delete;
     void operator = (const Connection &) = delete;
 
+    // Connections are allocated from the slab of the creating thread.
+    static void * operator new (std::size_t size);
+    static void operator delete (void *ptr);
+
     int Send(std::unique_ptr<Buffer> buffer);
+
+    // Send length bytes of file from offset by sendfile, the segment is
+    // queued after the buffers sent before. fd is duplicated, so caller
+    // could close it after SendFile returns.
+    int SendFile(int fd, off_t offset, std::size_t length);
+
     int Recv(Buffer *buffer);
     void Shutdown(ShutdownT type);
     void Close();
@@ -52,92 +110,369 @@ public:
     void SetTcpNoDelay();
     bool GetPeerAddress(struct sockaddr_in *inet);
 
-    void SetOnError(const OnError &oe);
-    void SetOnReceivable(const OnReceivable &onr);
-    void SetOnSendComplete(const OnSendComplete &osc);
+    // RTT, congestion window, retransmits and unacked segments from the
+    // kernel, slow network shows here while slow peer shows a growing
+    // send queue with a healthy RTT. Return false if it is not supported.
+    bool GetTcpInfo(TcpInfo *info) const;
+
+    // CPU which processed the received packets, accepted connections
+    // could be placed on the loop pinned to it by CpuLoopMap.
+    int GetIncomingCpu() const;
+
+    // Count the traffic of this connection, the counters are added to
+    // the stats of its event loop too. Stats are all zeros until they
+    // are enabled.
+    void EnableStats();
+    ConnectionStats GetStats() const;
+
+    // Timestamp received and sent data by SO_TIMESTAMPING, to tell the
+    // delay of network stack from the delay of event loop. Timestamps of
+    // the data returned by the last Recv are kept, timestamps of sent
+    // data are reported through OnSendTimestamp when the kernel reports
+    // them. Return false when it is not supported.
+    bool EnableTimestamping();
+    bool GetRecvTimestamp(RecvTimestamp *timestamp) const;
+    void SetOnSendTimestamp(OnSendTimestamp ost);
+
+    virtual int Fd() const override
+    {
+        return fd_;
+    }
+
+    // OnReceivable must be set while reading is enabled, OnError is
+    // optional.
+    void SetOnError(OnError oe);
+    void SetOnReceivable(OnReceivable onr);
+    void SetOnSendComplete(OnSendComplete osc);
+
+    // Move the connection to loop in the thread of both loops.
     void ChangeEventLoop(EventLoop *loop);
 
+    // Move the connection between loops of different threads: Detach it
+    // in the thread of its loop, hand it over, then Attach it in the
+    // thread of the new loop. Send queue, enabled events and other states
+    // are kept, events arrived in between are reported by the new loop.
+    // Read scheduler and send queue budget belong to the old loop, Detach
+    // leaves them and Attach joins scheduler and budget of the new loop,
+    // in the same read group. Callbacks are kept, reset them for the new
+    // thread. Backpressure pairs with other connections are reset, since
+    // those stay in the old thread, and the reads they paused are resumed.
+    void Detach();
+    void Attach(EventLoop *loop, ReadScheduler *scheduler = nullptr,
+                SendQueueBudget *budget = nullptr);
+
+    // Stop/restart reading events of the connection. Pauses by the user
+    // and by backpressure are kept apart, ResumeRead only resumes the
+    // pause of the user. Reading never restarts after the peer closed.
+    void PauseRead();
+    void ResumeRead();
+
+    // Wait the connection to be writable, OnSendComplete is called
+    // when it is writable and the send queue is empty.
+    void WaitWritable();
+
+    // OnHighWatermark is called when the bytes queued for sending reach
+    // high, then OnLowWatermark is called when they drop to low, but
+    // not when Close drops them. High watermark 0 disables the
+    // watermarks.
+    void SetSendWatermarks(std::size_t low, std::size_t high);
+    void SetOnHighWatermark(OnHighWatermark ohw);
+    void SetOnLowWatermark(OnLowWatermark olw);
+
+    // Pause reading of source connection when the send queue of this
+    // connection is above high watermark, and resume reading of it
+    // when below low watermark or when Close drops the send queue.
+    // Source must be of the same loop, and it backs one connection at a
+    // time, setting it for another connection resets the previous pair.
+    // Destroying or detaching either connection resets the pair too.
+    void SetBackpressureSource(Connection *source);
+    std::size_t GetQueuedSendBytes() const;
+
+    // Time point when the oldest unsent data in the send queue was
+    // queued, it is only tracked under a send queue budget.
+    std::chrono::steady_clock::time_point GetOldestUnsentTime() const;
+
+    // Let budget watch this connection, the connection may be evicted
+    // when the process-wide send queue bytes exceed the budget. Evicted
+    // connection drops its send queue, closes, then calls OnError.
+    void SetSendQueueBudget(SendQueueBudget *budget);
+
+    // Let scheduler bound the reading of this connection in each round
+    // by the budgets of group, see ReadScheduler. Scheduler must be of
+    // the event loop of this connection, ChangeEventLoop resets it.
+    void SetReadScheduler(ReadScheduler *scheduler, int group = 0);
+
+    // Send buffers not smaller than threshold by MSG_ZEROCOPY, these
+    // buffers are destructed when the kernel notifies the completion, and
+    // OnSendComplete waits for the completions too. Close hands the
+    // socket and the buffers waiting for completion over to the loop,
+    // which closes the socket after the completions, or after a timeout
+    // when they never arrive. Return false when zero-copy is not
+    // supported.
+    bool EnableZeroCopy(std::size_t threshold = kZeroCopyThreshold);
+
 private:
-    class ConnectionEventHandler final : public EventHandler
+    friend class ReadScheduler;
+    friend class SendQueueBudget;
+
+    template<typename... Handlers>
+    friend class EventDispatcher;
+
+    struct FileSegment
     {
-    public:
-        explicit ConnectionEventHandler(Connection *connection)
-            : events_(0),
-              enabled_events_(0),
-              connection_(connection)
+        int fd;
+        off_t offset;
+        std::size_t size;
+        std::size_t pos;
+
+        FileSegment(int f, off_t o, std::size_t s)
+            : fd(f), offset(o), size(s), pos(0)
         {
-            events_ |= static_cast<int>(Event::Read);
-            events_ |= static_cast<int>(Event::Write);
-            EnableRead();
         }
 
-        ConnectionEventHandler(const ConnectionEventHandler &) = delete;
-        void operator = (const ConnectionEventHandler &) = delete;
+        FileSegment(const FileSegment &) = delete;
+        void operator = (const FileSegment &) = delete;
 
-        void EnableRead()
+        ~FileSegment()
         {
-            enabled_events_ |= static_cast<int>(Event::Read);
+            close(fd);
         }
+    };
+
+    // Node of intrusive send queue, either a buffer or a file segment.
+    struct SendItem
+    {
+        SendItem *next;
+        std::unique_ptr<Buffer> buffer;
+        std::unique_ptr<FileSegment> file;
+        // Set when the item is queued under a send queue budget.
+        std::chrono::steady_clock::time_point queued_time;
+        uint32_t zerocopy_id;
+        bool zerocopy;
 
-        void EnableWrite()
+        SendItem()
+            : next(nullptr),
+              zerocopy_id(0),
+              zerocopy(false)
         {
-            enabled_events_ |= static_cast<int>(Event::Write);
         }
 
-        void DisableRead()
+        std::size_t Remain() const
         {
-            enabled_events_ &= ~static_cast<int>(Event::Read);
+            if (buffer)
+                return buffer->size - buffer->pos;
+            return file->size - file->pos;
         }
+    };
+
+    struct SendList
+    {
+        SendItem *head;
+        SendItem *tail;
 
-        void DisableWrite()
+        SendList()
+            : head(nullptr),
+              tail(nullptr)
         {
-            enabled_events_ &= ~static_cast<int>(Event::Write);
         }
 
-        virtual int Fd() const override
+        bool Empty() const
         {
-            return connection_->fd_;
+            return head == nullptr;
         }
 
-        virtual Event Events() const override
+        void Push(SendItem *item)
         {
-            return static_cast<Event>(events_);
+            item->next = nullptr;
+            if (tail)
+                tail->next = item;
+            else
+                head = item;
+            tail = item;
         }
 
-        virtual Event EnabledEvents() const override
+        SendItem * Pop()
         {
-            return static_cast<Event>(enabled_events_);
+            auto item = head;
+            head = item->next;
+            if (!head)
+                tail = nullptr;
+            return item;
         }
 
-        virtual void HandleRead() override
+        void Clear()
         {
-            connection_->HandleRead();
+            while (head)
+                delete Pop();
         }
 
-        virtual void HandleWrite() override
+        // Whether zero-copy id is before end, ids wrap around.
+        static bool IdBefore(uint32_t id, uint32_t end)
         {
-            connection_->HandleWrite();
+            return static_cast<int32_t>(id - end) < 0;
         }
 
-    private:
-        int events_;
-        int enabled_events_;
-        Connection *connection_;
+        // Delete the zero-copy items whose ids are before end.
+        void Complete(uint32_t end)
+        {
+            while (head && IdBefore(head->zerocopy_id, end))
+                delete Pop();
+        }
     };
 
-    using BufferQueue = std::queue<std::unique_ptr<Buffer>>;
+    class ZeroCopyLinger;
+
+    // States of send complete callback, watermarks, send queue budget,
+    // zero-copy, read scheduler, stats and timestamping.
+    struct Extension
+    {
+        OnSendComplete on_send_complete;
+        OnHighWatermark on_high_watermark;
+        OnLowWatermark on_low_watermark;
+
+        std::size_t low_watermark;
+        std::size_t high_watermark;
+        bool above_high_watermark;
+        Connection *backpressure_source;
+        // Connection whose backpressure source is this one.
+        Connection *backpressure_sink;
+
+        SendQueueBudget *send_queue_budget;
+        // Time point since when the send queue is not empty, tracked for
+        // the blocked time of stats.
+        std::chrono::steady_clock::time_point send_queue_since;
+
+        std::size_t zerocopy_threshold;
+        uint32_t zerocopy_next_id;
+        // TCP completes zero-copy sends in order, ids before it are all
+        // completed, even those of items not released yet.
+        uint32_t zerocopy_completed;
+        SendList zerocopy_list;
+
+        ReadScheduler *read_scheduler;
+        uint64_t read_round;
+        std::size_t read_bytes;
+        std::size_t read_messages;
+        int read_group;
+        bool read_parked;
+        // Slot of the connection in the scheduler while it is parked.
+        uint64_t read_park_slot;
+
+        bool stats_enabled;
+        ConnectionStats stats;
+
+        bool timestamping;
+        RecvTimestamp recv_timestamp;
+        OnSendTimestamp on_send_timestamp;
+        // Bytes written since timestamping was enabled, and the key of
+        // the first of them in the timestamps reported by the kernel.
+        uint64_t timestamp_bytes;
+        uint64_t timestamp_base;
+        // Bytes and time of the writes waiting for timestamps.
+        std::deque<std::pair<uint64_t, uint64_t>> timestamp_writes;
+
+        Extension()
+            : low_watermark(0),
+              high_watermark(0),
+              above_high_watermark(false),
+              backpressure_source(nullptr),
+              backpressure_sink(nullptr),
+              send_queue_budget(nullptr),
+              zerocopy_threshold(0),
+              zerocopy_next_id(0),
+              zerocopy_completed(0),
+              read_scheduler(nullptr),
+              read_round(0),
+              read_bytes(0),
+              read_messages(0),
+              read_group(0),
+              read_parked(false),
+              read_park_slot(0),
+              stats_enabled(false),
+              timestamping(false),
+              timestamp_bytes(0),
+              timestamp_base(0)
+        {
+        }
+    };
+
+    static const std::size_t kZeroCopyThreshold = 16 * 1024;
+
+    // Reasons of holding read events, read events are enabled when there
+    // is no reason and the read scheduler has not parked the connection.
+    static const unsigned char kReadHoldUser = 1;
+    static const unsigned char kReadHoldBackpressure = 2;
+    static const unsigned char kReadHoldPeerClosed = 4;
+    static const HandlerTag kHandlerTag = kConnectionHandlerTag;
+
+    // Handlers of frequent events are inline, so EventDispatcher could
+    // call them without function calls.
+    virtual Event Events() const override
+    {
+        return static_cast<Event>(static_cast<int>(Event::Read) |
+                                  static_cast<int>(Event::Write));
+    }
+
+    virtual Event EnabledEvents() const override
+    {
+        return static_cast<Event>(enabled_events_);
+    }
+
+    virtual void HandleRead() override
+    {
+        on_recv_();
+    }
+
+    virtual void HandleWrite() override;
+    virtual void HandleError() override;
+
+    Extension & Ext();
+    void EnableEvent(Event event);
+    void DisableEvent(Event event);
+    void UpdateEvents();
+    void HoldRead(unsigned char hold);
+    void ReleaseRead(unsigned char hold);
+    bool IsReadHeld() const;
 
-    int WriteBuffer(const std::unique_ptr<Buffer> &buffer);
-    void HandleRead();
-    void HandleWrite();
+    int QueueSendItem(SendItem item);
+    void PushSendItem(SendItem item);
+    int WriteItem(SendItem &item);
+    int WriteBuffer(SendItem &item);
+    int WriteFile(const std::unique_ptr<FileSegment> &file);
+    void AddQueuedBytes(std::size_t bytes);
+    void SubQueuedBytes(std::size_t bytes);
+    void DropSendQueue();
+    void ResetBackpressure();
+    void ReleaseItem(SendItem *item);
+    bool HasZeroCopyPending() const;
+    void LingerZeroCopy();
+    void ReadErrorQueue();
+    void CompleteZeroCopy(uint32_t id);
+    ssize_t RecvTimestamped(char *buf, std::size_t len);
+    void RecordWrite(std::size_t bytes, uint64_t send_ns);
+    void CompleteTimestamp(uint32_t key, uint64_t kernel_ns);
+    void CheckHighWatermark();
+    void CheckLowWatermark();
+    void CallSendComplete();
+    void HandleEvict();
+    std::size_t ReadBudget();
+    void ChargeRead(std::size_t bytes);
+    void CancelParkedRead();
+    void ResumeParkedRead();
+    void CountSent(std::size_t bytes);
+    void CountReceived(std::size_t bytes);
+    void CountSendBlocked();
 
+    // Packed with the tag of EventHandler.
+    unsigned char enabled_events_;
+    unsigned char read_holds_;
     int fd_;
     EventLoop *loop_;
     OnError on_error_;
     OnReceivable on_recv_;
-    OnSendComplete on_send_complete_;
-    BufferQueue send_queue_;
-    ConnectionEventHandler eh_;
+    std::size_t send_queue_bytes_;
+    SendList send_list_;
+    std::unique_ptr<Extension> ext_;
 };
 
 } // namespace snet
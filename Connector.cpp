@@ -25,9 +25,9 @@ Connector::~Connector()
         close(fd_);
 }
 
-void Connector::Connect(const OnConnected &oc)
+void Connector::Connect(OnConnected oc)
 {
-    oc_ = oc;
+    oc_ = std::move(oc);
 
     fd_ = socket(AF_INET, SOCK_STREAM, 0);
     if (fd_ < 0)
@@ -2,10 +2,10 @@
 #define CONNECTOR_H
 
 #include "Connection.h"
+#include "Delegate.h"
 #include "EventLoop.h"
 #include <string>
 #include <memory>
-#include <functional>
 
 namespace snet
 {
@@ -14,7 +14,7 @@ class Connector final
 {
 public:
     using ConnectionPtr = std::unique_ptr<Connection>;
-    using OnConnected = std::function<void (ConnectionPtr)>;
+    using OnConnected = Delegate<void (ConnectionPtr)>;
 
     Connector(const std::string &ip, unsigned short port,
               EventLoop *loop);
@@ -23,7 +23,7 @@ public:
     Connector(const Connector &) = delete;
     void operator = (const Connector &) = delete;
 
-    void Connect(const OnConnected &oc);
+    void Connect(OnConnected oc);
 
 private:
     class ConnectorEventHandler final : public EventHandler
@@ -0,0 +1,183 @@
+#ifndef DELEGATE_H
+#define DELEGATE_H
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace snet
+{
+
+// Default bytes of captures, enough for this pointer with three more words.
+const std::size_t kDelegateCapacity = 4 * sizeof(void *);
+
+template<typename Signature, std::size_t Capacity = kDelegateCapacity>
+class Delegate;
+
+// Move-only callable wrapper like std::function, but the callable is
+// always stored in the delegate itself and never allocated on heap.
+// Callables larger than Capacity are rejected at compile time.
+template<typename R, typename... Args, std::size_t Capacity>
+class Delegate<R (Args...), Capacity> final
+{
+public:
+    Delegate() noexcept
+        : invoke_(nullptr),
+          manage_(nullptr)
+    {
+    }
+
+    Delegate(std::nullptr_t) noexcept
+        : Delegate()
+    {
+    }
+
+    template<typename F, typename = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, Delegate>::value>::type>
+    Delegate(F &&f)
+        : Delegate()
+    {
+        Assign(std::forward<F>(f));
+    }
+
+    Delegate(Delegate &&other) noexcept
+        : Delegate()
+    {
+        MoveFrom(other);
+    }
+
+    Delegate & operator = (Delegate &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    Delegate & operator = (std::nullptr_t) noexcept
+    {
+        Reset();
+        return *this;
+    }
+
+    template<typename F, typename = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, Delegate>::value>::type>
+    Delegate & operator = (F &&f)
+    {
+        Reset();
+        Assign(std::forward<F>(f));
+        return *this;
+    }
+
+    Delegate(const Delegate &) = delete;
+    void operator = (const Delegate &) = delete;
+
+    ~Delegate()
+    {
+        Reset();
+    }
+
+    explicit operator bool () const noexcept
+    {
+        return invoke_ != nullptr;
+    }
+
+    // Must not be empty, check optional delegates by operator bool.
+    R operator () (Args... args) const
+    {
+        assert(invoke_ && "empty Delegate called");
+        return invoke_(&storage_, std::forward<Args>(args)...);
+    }
+
+private:
+    enum class Op
+    {
+        Move,
+        Destroy
+    };
+
+    using Storage = typename std::aligned_storage<
+        Capacity, alignof(void *)>::type;
+    using Invoke = R (*)(void *, Args &&...);
+    using Manage = void (*)(Op, void *, void *);
+
+    template<typename F>
+    static R InvokeFunc(void *storage, Args &&... args)
+    {
+        return (*static_cast<F *>(storage))(std::forward<Args>(args)...);
+    }
+
+    template<typename F>
+    static void ManageFunc(Op op, void *dst, void *src)
+    {
+        auto f = static_cast<F *>(src);
+
+        switch (op)
+        {
+        case Op::Move:
+            new (dst) F(std::move(*f));
+            f->~F();
+            break;
+
+        case Op::Destroy:
+            f->~F();
+            break;
+        }
+    }
+
+    template<typename F>
+    void Assign(F &&f)
+    {
+        using Func = typename std::decay<F>::type;
+
+        static_assert(sizeof(Func) <= Capacity,
+                      "Callable is too large for Delegate");
+        static_assert(alignof(Func) <= alignof(Storage),
+                      "Callable is over-aligned for Delegate");
+
+        new (&storage_) Func(std::forward<F>(f));
+        invoke_ = &InvokeFunc<Func>;
+
+        // Trivial callables, e.g. lambdas capturing pointers, are moved
+        // by copying the storage and need no destruction.
+        manage_ = std::is_trivially_copyable<Func>::value ?
+            nullptr : &ManageFunc<Func>;
+    }
+
+    void MoveFrom(Delegate &other) noexcept
+    {
+        if (!other.invoke_)
+            return ;
+
+        if (other.manage_)
+            other.manage_(Op::Move, &storage_, &other.storage_);
+        else
+            storage_ = other.storage_;
+
+        invoke_ = other.invoke_;
+        manage_ = other.manage_;
+        other.invoke_ = nullptr;
+        other.manage_ = nullptr;
+    }
+
+    void Reset() noexcept
+    {
+        if (manage_)
+            manage_(Op::Destroy, nullptr, &storage_);
+
+        invoke_ = nullptr;
+        manage_ = nullptr;
+    }
+
+    Invoke invoke_;
+    Manage manage_;
+    mutable Storage storage_;
+};
+
+} // namespace snet
+
+#endif // DELEGATE_H
@@ -0,0 +1,255 @@
+#include "DelimiterCodec.h"
+#include <stdexcept>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SNET_SCAN_X86 1
+#endif
+
+namespace
+{
+
+const char * FindScalar(const char *begin, const char *end,
+                        const char *delim, std::size_t n)
+{
+    if (static_cast<std::size_t>(end - begin) < n)
+        return end;
+
+    auto limit = end - n + 1;
+    auto p = begin;
+
+    while (p < limit)
+    {
+        p = static_cast<const char *>(memchr(p, delim[0], limit - p));
+        if (!p)
+            return end;
+
+        if (memcmp(p + 1, delim + 1, n - 1) == 0)
+            return p;
+        ++p;
+    }
+
+    return end;
+}
+
+#if defined(SNET_SCAN_X86) && defined(__SSE2__)
+
+// Compare the first and the last byte of delimiter at the same time,
+// only the candidates which match both need to compare the middle bytes.
+const char * FindSSE2(const char *begin, const char *end,
+                      const char *delim, std::size_t n)
+{
+    if (static_cast<std::size_t>(end - begin) < n)
+        return end;
+
+    const auto first = _mm_set1_epi8(delim[0]);
+    const auto last = _mm_set1_epi8(delim[n - 1]);
+
+    auto limit = end - n + 1;
+    auto p = begin;
+
+    for (; limit - p >= 16; p += 16)
+    {
+        auto block_first = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(p));
+        auto block_last = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(p + n - 1));
+
+        auto eq = _mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                _mm_cmpeq_epi8(block_last, last));
+        unsigned int mask = _mm_movemask_epi8(eq);
+
+        while (mask)
+        {
+            auto bit = __builtin_ctz(mask);
+            if (n <= 2 || memcmp(p + bit + 1, delim + 1, n - 2) == 0)
+                return p + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    return FindScalar(p, end, delim, n);
+}
+
+__attribute__((target("avx2")))
+const char * FindAVX2(const char *begin, const char *end,
+                      const char *delim, std::size_t n)
+{
+    if (static_cast<std::size_t>(end - begin) < n)
+        return end;
+
+    const auto first = _mm256_set1_epi8(delim[0]);
+    const auto last = _mm256_set1_epi8(delim[n - 1]);
+
+    auto limit = end - n + 1;
+    auto p = begin;
+
+    for (; limit - p >= 32; p += 32)
+    {
+        auto block_first = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(p));
+        auto block_last = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(p + n - 1));
+
+        auto eq = _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                   _mm256_cmpeq_epi8(block_last, last));
+        unsigned int mask = _mm256_movemask_epi8(eq);
+
+        while (mask)
+        {
+            auto bit = __builtin_ctz(mask);
+            if (n <= 2 || memcmp(p + bit + 1, delim + 1, n - 2) == 0)
+                return p + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    return FindSSE2(p, end, delim, n);
+}
+
+#endif // SNET_SCAN_X86 && __SSE2__
+
+} // namespace
+
+namespace snet
+{
+
+bool IsScanKernelSupported(ScanKernel kernel)
+{
+    switch (kernel)
+    {
+    case ScanKernel::Scalar:
+        return true;
+
+#if defined(SNET_SCAN_X86) && defined(__SSE2__)
+    case ScanKernel::SSE2:
+        return true;
+
+    case ScanKernel::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+
+    default:
+        return false;
+    }
+}
+
+ScanKernel GetBestScanKernel()
+{
+    static const ScanKernel best =
+        IsScanKernelSupported(ScanKernel::AVX2) ? ScanKernel::AVX2 :
+        IsScanKernelSupported(ScanKernel::SSE2) ? ScanKernel::SSE2 :
+        ScanKernel::Scalar;
+    return best;
+}
+
+DelimiterScanner::DelimiterScanner(const std::string &delimiter)
+    : DelimiterScanner(delimiter, GetBestScanKernel())
+{
+}
+
+DelimiterScanner::DelimiterScanner(const std::string &delimiter,
+                                   ScanKernel kernel)
+    : delimiter_(delimiter),
+      kernel_(IsScanKernelSupported(kernel) ? kernel : ScanKernel::Scalar),
+      find_(FindScalar)
+{
+    // Kernels read the last byte of delimiter.
+    if (delimiter_.empty())
+        throw std::invalid_argument("empty delimiter");
+
+#if defined(SNET_SCAN_X86) && defined(__SSE2__)
+    if (kernel_ == ScanKernel::SSE2)
+        find_ = FindSSE2;
+    else if (kernel_ == ScanKernel::AVX2)
+        find_ = FindAVX2;
+#endif
+}
+
+DelimiterCodec::DelimiterCodec(Connection *connection,
+                               const std::string &delimiter,
+                               std::size_t max_record_size)
+    : connection_(connection),
+      scanner_(delimiter),
+      capacity_(max_record_size + delimiter.size()),
+      data_(new char[capacity_]),
+      buffer_(data_.get(), capacity_),
+      record_begin_(0),
+      scan_pos_(0)
+{
+    connection_->SetOnReceivable([this] () { HandleReceivable(); });
+}
+
+void DelimiterCodec::SetOnRecord(OnRecord on_record)
+{
+    on_record_ = std::move(on_record);
+}
+
+void DelimiterCodec::SetOnError(OnError on_error)
+{
+    on_error_ = std::move(on_error);
+}
+
+void DelimiterCodec::HandleReceivable()
+{
+    auto ret = connection_->Recv(&buffer_);
+    if (ret == static_cast<int>(RecvE::PeerClosed))
+        return ReportError(CodecE::PeerClosed);
+
+    if (ret == static_cast<int>(RecvE::Error))
+        return ReportError(CodecE::RecvError);
+
+    if (ret == static_cast<int>(RecvE::NoAvailData))
+        return ;
+
+    buffer_.pos += ret;
+    SplitRecords();
+}
+
+void DelimiterCodec::SplitRecords()
+{
+    auto data = data_.get();
+    auto end = data + buffer_.pos;
+    auto delimiter_size = scanner_.Size();
+
+    while (true)
+    {
+        auto found = scanner_.Find(data + scan_pos_, end);
+        if (found == end)
+            break;
+
+        Record record;
+        record.data = data + record_begin_;
+        record.size = found - record.data;
+
+        record_begin_ = found - data + delimiter_size;
+        scan_pos_ = record_begin_;
+        on_record_(record);
+    }
+
+    // Delimiter may be split by two receives, rescan its prefix next time.
+    if (buffer_.pos - scan_pos_ >= delimiter_size)
+        scan_pos_ = buffer_.pos - delimiter_size + 1;
+
+    if (record_begin_ > 0)
+    {
+        auto remain = buffer_.pos - record_begin_;
+        memmove(data, data + record_begin_, remain);
+
+        buffer_.pos = remain;
+        scan_pos_ -= record_begin_;
+        record_begin_ = 0;
+    }
+
+    if (buffer_.pos == buffer_.size)
+        ReportError(CodecE::RecordTooLarge);
+}
+
+void DelimiterCodec::ReportError(CodecE error)
+{
+    if (on_error_)
+        on_error_(error);
+}
+
+} // namespace snet
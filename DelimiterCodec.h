@@ -0,0 +1,117 @@
+#ifndef DELIMITER_CODEC_H
+#define DELIMITER_CODEC_H
+
+#include "Connection.h"
+#include "Delegate.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace snet
+{
+
+enum class ScanKernel
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+bool IsScanKernelSupported(ScanKernel kernel);
+ScanKernel GetBestScanKernel();
+
+// Find single- or multi-byte delimiter in a memory block, the kernel is
+// selected at runtime according to the CPU features. Empty delimiter is
+// rejected by std::invalid_argument.
+class DelimiterScanner final
+{
+public:
+    explicit DelimiterScanner(const std::string &delimiter);
+    DelimiterScanner(const std::string &delimiter, ScanKernel kernel);
+
+    DelimiterScanner(const DelimiterScanner &) = delete;
+    void operator = (const DelimiterScanner &) = delete;
+
+    // Return the first position of delimiter in [begin, end),
+    // return end when not found.
+    const char * Find(const char *begin, const char *end) const
+    {
+        return find_(begin, end, delimiter_.data(), delimiter_.size());
+    }
+
+    std::size_t Size() const
+    {
+        return delimiter_.size();
+    }
+
+    ScanKernel Kernel() const
+    {
+        return kernel_;
+    }
+
+private:
+    using FindFunc = const char * (*)(const char *, const char *,
+                                      const char *, std::size_t);
+
+    std::string delimiter_;
+    ScanKernel kernel_;
+    FindFunc find_;
+};
+
+// Record view which points into the receive buffer of DelimiterCodec,
+// it is valid only in OnRecord callback.
+struct Record
+{
+    const char *data;
+    std::size_t size;
+};
+
+enum class CodecE
+{
+    PeerClosed,
+    RecvError,
+    RecordTooLarge
+};
+
+// Split the data received from Connection into records by the delimiter,
+// the delimiter is not included in the record. Empty delimiter is
+// rejected by std::invalid_argument.
+class DelimiterCodec final
+{
+public:
+    using OnRecord = Delegate<void (const Record &)>;
+    using OnError = Delegate<void (CodecE)>;
+
+    DelimiterCodec(Connection *connection, const std::string &delimiter,
+                   std::size_t max_record_size = kDefaultMaxRecordSize);
+
+    DelimiterCodec(const DelimiterCodec &) = delete;
+    void operator = (const DelimiterCodec &) = delete;
+
+    // OnRecord must be set before data arrives, OnError is optional.
+    void SetOnRecord(OnRecord on_record);
+    void SetOnError(OnError on_error);
+
+private:
+    void HandleReceivable();
+    void SplitRecords();
+    void ReportError(CodecE error);
+
+    static const std::size_t kDefaultMaxRecordSize = 64 * 1024;
+
+    Connection *connection_;
+    DelimiterScanner scanner_;
+
+    std::size_t capacity_;
+    std::unique_ptr<char []> data_;
+    Buffer buffer_;
+    std::size_t record_begin_;
+    std::size_t scan_pos_;
+
+    OnRecord on_record_;
+    OnError on_error_;
+};
+
+} // namespace snet
+
+#endif // DELIMITER_CODEC_H
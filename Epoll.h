@@ -1,39 +1,224 @@
 #ifndef EPOLL_H
 #define EPOLL_H
 
+#include "EventDispatcher.h"
 #include "EventLoop.h"
+#include "HandlerTable.h"
+#include "LoopMonitor.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <string.h>
+#include <chrono>
 #include <memory>
 
-struct epoll_event;
-
 namespace snet
 {
 
-class Epoll final : public EventLoop
+// Event loop of epoll, Dispatcher decides which handler types are called
+// without virtual functions. Use it through EventLoop as usual, or use
+// the concrete type directly to avoid virtual calls to the loop.
+// UpdateEvents only marks the handler, the events of it are updated once
+// before next wait when they differ from the registered ones.
+template<typename Dispatcher>
+class BasicEpoll final : public EventLoop
 {
 public:
-    Epoll();
-    ~Epoll();
+    BasicEpoll()
+        : stop_(false),
+          epoll_fd_(epoll_create(1)),
+          events_(new struct epoll_event[kMaxEvents])
+    {
+    }
+
+    ~BasicEpoll()
+    {
+        if (epoll_fd_ >= 0)
+            close(epoll_fd_);
+    }
+
+    virtual void AddEventHandler(EventHandler *eh) override
+    {
+        auto fd = Dispatcher::Fd(eh);
+        auto events = static_cast<int>(Dispatcher::EnabledEvents(eh));
+        auto key = handlers_.Add(fd, eh, events);
+        SetEpollEvents(EPOLL_CTL_ADD, fd, key, events);
+        Counters().handlers.Add(1);
+    }
+
+    virtual void DelEventHandler(EventHandler *eh) override
+    {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+
+        auto fd = Dispatcher::Fd(eh);
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, &event);
+
+        // Pending events of the handler are dropped by the generation.
+        handlers_.Del(fd);
+
+        auto &counters = Counters();
+        counters.ctl_calls.Add(1);
+        counters.handlers.Sub(1);
+    }
+
+    virtual void UpdateEvents(EventHandler *eh) override
+    {
+        handlers_.MarkPending(Dispatcher::Fd(eh));
+    }
+
+    virtual void AddLoopHandler(LoopHandler *lh) override
+    {
+        lh_set_.AddLoopHandler(lh);
+    }
+
+    virtual void DelLoopHandler(LoopHandler *lh) override
+    {
+        lh_set_.DelLoopHandler(lh);
+    }
+
+    virtual void Loop() override
+    {
+        using Clock = std::chrono::steady_clock;
+
+        auto &counters = Counters();
+        auto busy_begin = Clock::now();
+
+        while (!stop_)
+        {
+            auto monitor = Monitor();
+
+            if (handlers_.HasPending())
+                ApplyUpdates();
+
+            auto timeout = lh_set_.HasPendingWork() ? 0 : 20;
+            SNET_TRACE(WaitBegin, -1, timeout);
+            auto wait_begin = Clock::now();
+            auto num = epoll_wait(epoll_fd_, events_.get(),
+                                  kMaxEvents, timeout);
+            auto wait_end = Clock::now();
+            SNET_TRACE(WaitEnd, -1, num > 0 ? num : 0);
+
+            counters.busy_ns.Add(ToNanoseconds(wait_begin - busy_begin));
+            counters.blocked_ns.Add(ToNanoseconds(wait_end - wait_begin));
+            busy_begin = wait_end;
 
-    virtual void AddEventHandler(EventHandler *eh) override;
-    virtual void DelEventHandler(EventHandler *eh) override;
-    virtual void UpdateEvents(EventHandler *eh) override;
-    virtual void AddLoopHandler(LoopHandler *lh) override;
-    virtual void DelLoopHandler(LoopHandler *lh) override;
-    virtual void Loop() override;
-    virtual void Stop() override;
+            if (monitor)
+                monitor->BeginIteration();
+
+            uint64_t callbacks = 0;
+            for (int i = 0; i < num; ++i)
+            {
+                // Handler may be deleted by the previous callback,
+                // so find it again before each callback.
+                auto key = events_[i].data.u64;
+                auto fd = static_cast<int>(static_cast<uint32_t>(key));
+                SNET_TRACE(FdReady, fd, events_[i].events);
+
+                if (events_[i].events & EPOLLIN)
+                {
+                    auto eh = handlers_.Find(key);
+                    if (eh)
+                    {
+                        CallbackScope scope(monitor, CallbackSite::Read,
+                                            eh, fd);
+                        Dispatcher::HandleRead(eh);
+                        ++callbacks;
+                    }
+                }
+
+                if (events_[i].events & EPOLLOUT)
+                {
+                    auto eh = handlers_.Find(key);
+                    if (eh)
+                    {
+                        CallbackScope scope(monitor, CallbackSite::Write,
+                                            eh, fd);
+                        Dispatcher::HandleWrite(eh);
+                        ++callbacks;
+                    }
+                }
+
+                // Handlers read their error queues, pending socket
+                // errors are also reported by reads and writes.
+                if (events_[i].events & EPOLLERR)
+                {
+                    auto eh = handlers_.Find(key);
+                    if (eh)
+                    {
+                        CallbackScope scope(monitor, CallbackSite::Error,
+                                            eh, fd);
+                        Dispatcher::HandleError(eh);
+                        ++callbacks;
+                    }
+                }
+            }
+
+            counters.iterations.Add(1);
+            counters.events.Add(num > 0 ? num : 0);
+            counters.callbacks.Add(callbacks);
+
+            lh_set_.HandleLoop(monitor);
+
+            if (monitor)
+                monitor->EndIteration();
+        }
+
+        counters.busy_ns.Add(ToNanoseconds(Clock::now() - busy_begin));
+        lh_set_.HandleStop();
+    }
+
+    virtual void Stop() override
+    {
+        stop_ = true;
+    }
 
 private:
-    void SetEpollEvents(int op, EventHandler *eh);
+    void ApplyUpdates()
+    {
+        handlers_.ApplyPending(
+            [this] (int fd, uint64_t key, EventHandler *eh, int registered) {
+                auto events = static_cast<int>(Dispatcher::EnabledEvents(eh));
+                if (events != registered)
+                    SetEpollEvents(EPOLL_CTL_MOD, fd, key, events);
+                return events;
+            });
+    }
+
+    void SetEpollEvents(int op, int fd, uint64_t key, int events)
+    {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+
+        if (events & static_cast<int>(Event::Read))
+            event.events |= EPOLLIN;
+
+        if (events & static_cast<int>(Event::Write))
+            event.events |= EPOLLOUT;
 
-    static const int kMaxEvents = 10;
+        event.data.u64 = key;
+
+        epoll_ctl(epoll_fd_, op, fd, &event);
+        Counters().ctl_calls.Add(1);
+    }
+
+    template<typename Duration>
+    static uint64_t ToNanoseconds(const Duration &duration)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            duration).count();
+    }
+
+    static const int kMaxEvents = 256;
 
     bool stop_;
     int epoll_fd_;
+    HandlerTable handlers_;
     LoopHandlerSet lh_set_;
     std::unique_ptr<struct epoll_event []> events_;
 };
 
+using Epoll = BasicEpoll<DefaultEventDispatcher>;
+
 } // namespace snet
 
 #endif // EPOLL_H
@@ -0,0 +1,109 @@
+#ifndef EVENT_DISPATCHER_H
+#define EVENT_DISPATCHER_H
+
+#include "Acceptor.h"
+#include "Connection.h"
+#include "EventLoop.h"
+
+namespace snet
+{
+
+// Dispatch events to handlers of the listed types by non-virtual calls,
+// each type provides its tag as static member kHandlerTag. Handlers of
+// other types are dispatched through virtual functions.
+template<typename... Handlers>
+class EventDispatcher;
+
+template<>
+class EventDispatcher<> final
+{
+public:
+    static int Fd(const EventHandler *eh)
+    {
+        return eh->Fd();
+    }
+
+    static Event Events(const EventHandler *eh)
+    {
+        return eh->Events();
+    }
+
+    static Event EnabledEvents(const EventHandler *eh)
+    {
+        return eh->EnabledEvents();
+    }
+
+    static void HandleRead(EventHandler *eh)
+    {
+        eh->HandleRead();
+    }
+
+    static void HandleWrite(EventHandler *eh)
+    {
+        eh->HandleWrite();
+    }
+
+    static void HandleError(EventHandler *eh)
+    {
+        eh->HandleError();
+    }
+};
+
+template<typename Handler, typename... Handlers>
+class EventDispatcher<Handler, Handlers...> final
+{
+public:
+    static int Fd(const EventHandler *eh)
+    {
+        if (eh->Tag() == Handler::kHandlerTag)
+            return static_cast<const Handler *>(eh)->Handler::Fd();
+        return Next::Fd(eh);
+    }
+
+    static Event Events(const EventHandler *eh)
+    {
+        if (eh->Tag() == Handler::kHandlerTag)
+            return static_cast<const Handler *>(eh)->Handler::Events();
+        return Next::Events(eh);
+    }
+
+    static Event EnabledEvents(const EventHandler *eh)
+    {
+        if (eh->Tag() == Handler::kHandlerTag)
+            return static_cast<const Handler *>(eh)->Handler::EnabledEvents();
+        return Next::EnabledEvents(eh);
+    }
+
+    static void HandleRead(EventHandler *eh)
+    {
+        if (eh->Tag() == Handler::kHandlerTag)
+            return static_cast<Handler *>(eh)->Handler::HandleRead();
+        Next::HandleRead(eh);
+    }
+
+    static void HandleWrite(EventHandler *eh)
+    {
+        if (eh->Tag() == Handler::kHandlerTag)
+            return static_cast<Handler *>(eh)->Handler::HandleWrite();
+        Next::HandleWrite(eh);
+    }
+
+    static void HandleError(EventHandler *eh)
+    {
+        if (eh->Tag() == Handler::kHandlerTag)
+            return static_cast<Handler *>(eh)->Handler::HandleError();
+        Next::HandleError(eh);
+    }
+
+private:
+    using Next = EventDispatcher<Handlers...>;
+};
+
+// Dispatch all events through virtual functions.
+using VirtualEventDispatcher = EventDispatcher<>;
+
+using DefaultEventDispatcher = EventDispatcher<Connection, Acceptor>;
+
+} // namespace snet
+
+#endif // EVENT_DISPATCHER_H
@@ -1,7 +1,12 @@
 #include "EventLoop.h"
+#include "LoopMonitor.h"
+#include <signal.h>
+
+#ifdef __APPLE__
 #include "KQueue.h"
+#elif __linux__
 #include "Epoll.h"
-#include <signal.h>
+#endif
 
 namespace
 {
@@ -35,10 +40,15 @@ void LoopHandlerSet::DelLoopHandler(LoopHandler *lh)
     set_.erase(lh);
 }
 
-void LoopHandlerSet::HandleLoop()
+void LoopHandlerSet::HandleLoop(LoopMonitor *monitor)
 {
-    for (auto lh : set_)
+    // Handler may delete itself in HandleLoop.
+    for (auto it = set_.begin(); it != set_.end(); )
+    {
+        auto lh = *it++;
+        CallbackScope scope(monitor, CallbackSite::Loop, lh, -1);
         lh->HandleLoop();
+    }
 }
 
 void LoopHandlerSet::HandleStop()
@@ -47,6 +57,17 @@ void LoopHandlerSet::HandleStop()
         lh->HandleStop();
 }
 
+bool LoopHandlerSet::HasPendingWork() const
+{
+    for (auto lh : set_)
+    {
+        if (lh->HasPendingWork())
+            return true;
+    }
+
+    return false;
+}
+
 std::unique_ptr<EventLoop> CreateEventLoop()
 {
 #ifdef __APPLE__
@@ -1,27 +1,61 @@
 #ifndef EVENT_LOOP_H
 #define EVENT_LOOP_H
 
+#include "LoopStats.h"
 #include <memory>
 #include <set>
 
 namespace snet
 {
 
+class LoopMonitor;
+
 enum class Event : int
 {
     Read = 1,
     Write = 2
 };
 
+// Tag of event handler type, EventDispatcher calls the handlers with
+// known tags directly instead of through virtual functions.
+using HandlerTag = unsigned char;
+
+const HandlerTag kGenericHandlerTag = 0;
+const HandlerTag kConnectionHandlerTag = 1;
+const HandlerTag kAcceptorHandlerTag = 2;
+
+// Tags from this value are free for handlers outside the library.
+const HandlerTag kUserHandlerTag = 64;
+
 class EventHandler
 {
 public:
+    EventHandler()
+        : tag_(kGenericHandlerTag)
+    {
+    }
+
+    explicit EventHandler(HandlerTag tag)
+        : tag_(tag)
+    {
+    }
+
     virtual ~EventHandler() { }
+
+    HandlerTag Tag() const
+    {
+        return tag_;
+    }
+
     virtual int Fd() const = 0;
     virtual Event Events() const = 0;
     virtual Event EnabledEvents() const = 0;
     virtual void HandleRead() = 0;
     virtual void HandleWrite() = 0;
+    virtual void HandleError() { }
+
+private:
+    HandlerTag tag_;
 };
 
 class LoopHandler
@@ -30,12 +64,19 @@ public:
     virtual ~LoopHandler() { }
     virtual void HandleLoop() = 0;
     virtual void HandleStop() = 0;
+
+    // Event loop polls without waiting when a handler has pending work.
+    virtual bool HasPendingWork() const { return false; }
 };
 
 class EventLoop
 {
 public:
-    EventLoop() { }
+    EventLoop()
+        : monitor_(nullptr)
+    {
+    }
+
     EventLoop(const EventLoop &) = delete;
     void operator = (const EventLoop &) = delete;
 
@@ -47,6 +88,34 @@ public:
     virtual void DelLoopHandler(LoopHandler *lh) = 0;
     virtual void Loop() = 0;
     virtual void Stop() = 0;
+
+    // Snapshot of the counters, it is safe to call from any thread.
+    LoopStats GetStats() const
+    {
+        return counters_.Snapshot();
+    }
+
+    // Counters are updated by the loop and its handlers in loop thread.
+    LoopCounters & Counters()
+    {
+        return counters_;
+    }
+
+    // Time callbacks of the loop by monitor, set it before Loop or in
+    // loop thread, nullptr disables it.
+    void SetMonitor(LoopMonitor *monitor)
+    {
+        monitor_ = monitor;
+    }
+
+    LoopMonitor * Monitor() const
+    {
+        return monitor_;
+    }
+
+private:
+    LoopCounters counters_;
+    LoopMonitor *monitor_;
 };
 
 class LoopHandlerSet final
@@ -59,8 +128,9 @@ public:
 
     void AddLoopHandler(LoopHandler *lh);
     void DelLoopHandler(LoopHandler *lh);
-    void HandleLoop();
+    void HandleLoop(LoopMonitor *monitor);
     void HandleStop();
+    bool HasPendingWork() const;
 
 private:
     std::set<LoopHandler *> set_;
@@ -0,0 +1,348 @@
+#include "EventLoopPool.h"
+#include "Affinity.h"
+#include <algorithm>
+
+namespace snet
+{
+
+// Task of the loop taking over a connection. Connection is closed if the
+// task is dropped without running.
+class EventLoopPool::Arrival final
+{
+public:
+    Arrival(EventLoopPool *pool, Member *to,
+            std::unique_ptr<Connection> connection)
+        : pool_(pool),
+          to_(to),
+          connection_(std::move(connection))
+    {
+    }
+
+    Arrival(Arrival &&) = default;
+
+    void operator () ()
+    {
+        auto loop = to_->loop.get();
+        connection_->Attach(loop);
+        pool_->immigrate_(loop, std::move(connection_));
+    }
+
+private:
+    EventLoopPool *pool_;
+    Member *to_;
+    std::unique_ptr<Connection> connection_;
+};
+
+// Task of a loop giving up a share of its connections to a new loop.
+class EventLoopPool::Departure final
+{
+public:
+    Departure(EventLoopPool *pool, Member *from, Member *to,
+              std::size_t count)
+        : pool_(pool),
+          from_(from),
+          to_(to),
+          count_(count)
+    {
+    }
+
+    void operator () ()
+    {
+        for (std::size_t i = 0; i < count_; ++i)
+        {
+            auto connection = pool_->emigrate_(from_->loop.get());
+            if (!connection)
+                break;
+
+            connection->Detach();
+            pool_->Dispatch(std::move(connection), to_);
+        }
+    }
+
+private:
+    EventLoopPool *pool_;
+    Member *from_;
+    Member *to_;
+    std::size_t count_;
+};
+
+// Task of a retired loop giving up all of its connections, or closing
+// them when the pool is destroyed, then stopping the loop.
+class EventLoopPool::Retirement final
+{
+public:
+    Retirement(EventLoopPool *pool, Member *from, bool close)
+        : pool_(pool),
+          from_(from),
+          close_(close)
+    {
+    }
+
+    void operator () ()
+    {
+        auto loop = from_->loop.get();
+        while (auto connection = pool_->emigrate_(loop))
+        {
+            if (close_)
+                continue;
+
+            connection->Detach();
+            pool_->Dispatch(std::move(connection), nullptr);
+        }
+
+        loop->Stop();
+    }
+
+private:
+    EventLoopPool *pool_;
+    Member *from_;
+    bool close_;
+};
+
+EventLoopPool::EventLoopPool(const Options &options,
+                             Emigrate emigrate, Immigrate immigrate)
+    : options_(options),
+      emigrate_(std::move(emigrate)),
+      immigrate_(std::move(immigrate)),
+      active_(0),
+      stop_(false),
+      closing_(false),
+      next_(0),
+      high_intervals_(0),
+      low_intervals_(0),
+      thread_(&EventLoopPool::ControlFunc, this)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    options_.min_loops = std::max<std::size_t>(options_.min_loops, 1);
+    options_.max_loops = std::max(options_.max_loops, options_.min_loops);
+
+    for (std::size_t i = 0; i < options_.min_loops; ++i)
+        StartLoop(FreeMember());
+}
+
+EventLoopPool::~EventLoopPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    cond_.notify_one();
+    thread_.join();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+
+        for (auto &member : members_)
+        {
+            if (member->state == State::Active)
+                RetireLoop(member.get(), true);
+        }
+    }
+
+    // Retirement tasks dispatch connections with the lock.
+    for (auto &member : members_)
+    {
+        if (member->thread.joinable())
+            member->thread.join();
+    }
+}
+
+void EventLoopPool::AddConnection(std::unique_ptr<Connection> connection)
+{
+    Dispatch(std::move(connection), nullptr);
+}
+
+std::size_t EventLoopPool::GetLoopCount() const
+{
+    return active_.load(std::memory_order_relaxed);
+}
+
+void EventLoopPool::ControlFunc()
+{
+    auto last = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!cond_.wait_for(lock, options_.interval,
+                           [this] () { return stop_; }))
+    {
+        auto now = std::chrono::steady_clock::now();
+        Control(now - last);
+        last = now;
+    }
+}
+
+void EventLoopPool::Control(std::chrono::steady_clock::duration elapsed)
+{
+    // Threads of retired loops exit after giving up their connections.
+    for (auto &member : members_)
+    {
+        if (member->state == State::Retiring && member->exited)
+        {
+            member->thread.join();
+            member->loop.reset();
+            member->state = State::Stopped;
+        }
+    }
+
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        elapsed).count();
+    if (elapsed_ns <= 0)
+        return ;
+
+    double total = 0.0;
+    std::size_t active = 0;
+
+    for (auto &member : members_)
+    {
+        if (member->state != State::Active)
+            continue;
+
+        auto busy_ns = member->loop->GetStats().busy_ns;
+        member->busy = static_cast<double>(busy_ns - member->busy_ns) /
+            elapsed_ns;
+        member->busy_ns = busy_ns;
+
+        total += member->busy;
+        ++active;
+    }
+
+    if (active == 0)
+        return ;
+
+    auto average = total / active;
+    high_intervals_ = average > options_.grow_busy &&
+        active < options_.max_loops ? high_intervals_ + 1 : 0;
+    low_intervals_ = average < options_.shrink_busy &&
+        active > options_.min_loops ? low_intervals_ + 1 : 0;
+
+    if (high_intervals_ >= options_.sustain)
+    {
+        high_intervals_ = 0;
+        Grow();
+    }
+    else if (low_intervals_ >= options_.sustain)
+    {
+        low_intervals_ = 0;
+        Shrink();
+    }
+}
+
+void EventLoopPool::Grow()
+{
+    auto loops = active_.load(std::memory_order_relaxed);
+    auto member = FreeMember();
+    StartLoop(member);
+
+    // Other loops give the new loop an even share of their handlers.
+    for (auto &from : members_)
+    {
+        if (from.get() == member || from->state != State::Active)
+            continue;
+
+        auto share = from->loop->GetStats().handlers / (loops + 1);
+        if (share > 0)
+            from->tasks.Post(Departure(this, from.get(), member, share));
+    }
+}
+
+void EventLoopPool::Shrink()
+{
+    Member *idlest = nullptr;
+    for (auto &member : members_)
+    {
+        if (member->state == State::Active &&
+            (!idlest || member->busy < idlest->busy))
+            idlest = member.get();
+    }
+
+    if (idlest)
+        RetireLoop(idlest, false);
+}
+
+void EventLoopPool::StartLoop(Member *member)
+{
+    member->loop = CreateEventLoop();
+    member->loop->AddLoopHandler(&member->tasks);
+    member->state = State::Active;
+    member->busy_ns = 0;
+    member->busy = 0.0;
+    member->exited = false;
+    member->thread = std::thread(&EventLoopPool::LoopFunc, this, member);
+    ++active_;
+}
+
+void EventLoopPool::RetireLoop(Member *member, bool close)
+{
+    // No task is posted to the loop after its retirement, so connections
+    // dispatched to it before are passed on by the retirement.
+    member->state = State::Retiring;
+    member->tasks.Post(Retirement(this, member, close));
+    --active_;
+}
+
+void EventLoopPool::LoopFunc(Member *member)
+{
+    if (!options_.cpus.empty())
+        PinCurrentThreadToCpu(
+            options_.cpus[member->index % options_.cpus.size()]);
+
+    member->loop->Loop();
+    member->loop->DelLoopHandler(&member->tasks);
+    member->exited = true;
+}
+
+void EventLoopPool::Dispatch(std::unique_ptr<Connection> connection,
+                             Member *to)
+{
+    // Connection is closed out of the lock when there is no loop for it.
+    std::unique_ptr<Connection> dropped;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!to || to->state != State::Active)
+            to = NextActive();
+
+        if (closing_ || !to)
+            dropped = std::move(connection);
+        else
+            to->tasks.Post(Arrival(this, to, std::move(connection)));
+    }
+}
+
+EventLoopPool::Member * EventLoopPool::FreeMember()
+{
+    for (auto &member : members_)
+    {
+        if (member->state == State::Stopped)
+            return member.get();
+    }
+
+    std::unique_ptr<Member> member(new Member);
+    member->index = members_.size();
+    member->state = State::Stopped;
+    member->busy_ns = 0;
+    member->busy = 0.0;
+    member->exited = false;
+    members_.push_back(std::move(member));
+    return members_.back().get();
+}
+
+EventLoopPool::Member * EventLoopPool::NextActive()
+{
+    for (std::size_t i = 0; i < members_.size(); ++i)
+    {
+        auto index = (next_ + i) % members_.size();
+        if (members_[index]->state == State::Active)
+        {
+            next_ = index + 1;
+            return members_[index].get();
+        }
+    }
+    return nullptr;
+}
+
+} // namespace snet
@@ -0,0 +1,118 @@
+#ifndef EVENT_LOOP_POOL_H
+#define EVENT_LOOP_POOL_H
+
+#include "Connection.h"
+#include "Delegate.h"
+#include "EventLoop.h"
+#include "LoopTasks.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace snet
+{
+
+// Event loops running in threads of the pool. A thread of the pool
+// samples the busy time of loops every interval, it adds a loop when the
+// average busy fraction of loops stays above grow_busy, and retires the
+// idlest loop when it stays below shrink_busy. A new loop takes a share
+// of the connections of other loops, a retired loop gives all of its
+// connections to other loops before its thread exits.
+//
+// Connections are owned by the application: Emigrate gives up one
+// connection of a loop, Immigrate takes over a connection attached to a
+// loop. They are called in the threads of loops, concurrently for
+// different loops. Destroying the pool closes the connections of loops.
+class EventLoopPool final
+{
+public:
+    using Emigrate = Delegate<std::unique_ptr<Connection> (EventLoop *)>;
+    using Immigrate = Delegate<void (EventLoop *,
+                                     std::unique_ptr<Connection>)>;
+
+    struct Options
+    {
+        std::size_t min_loops = 1;
+        std::size_t max_loops = 1;
+        std::chrono::milliseconds interval = std::chrono::milliseconds(1000);
+        double grow_busy = 0.75;
+        double shrink_busy = 0.25;
+        // Intervals the busy fraction must stay above or below.
+        std::size_t sustain = 5;
+        // Loop threads are pinned to cpus in turn when it is not empty.
+        std::vector<int> cpus;
+    };
+
+    EventLoopPool(const Options &options,
+                  Emigrate emigrate, Immigrate immigrate);
+    ~EventLoopPool();
+
+    EventLoopPool(const EventLoopPool &) = delete;
+    void operator = (const EventLoopPool &) = delete;
+
+    // Give a connection not attached to any loop to a loop of the pool,
+    // it is safe to call from any thread.
+    void AddConnection(std::unique_ptr<Connection> connection);
+
+    std::size_t GetLoopCount() const;
+
+private:
+    enum class State
+    {
+        Stopped,
+        Active,
+        Retiring
+    };
+
+    // Slot of a loop, reused by the next loop after its thread exits.
+    struct Member
+    {
+        std::size_t index;
+        State state;
+        std::unique_ptr<EventLoop> loop;
+        LoopTasks tasks;
+        uint64_t busy_ns;
+        double busy;
+        std::atomic<bool> exited;
+        std::thread thread;
+    };
+
+    class Arrival;
+    class Departure;
+    class Retirement;
+
+    void ControlFunc();
+    void Control(std::chrono::steady_clock::duration elapsed);
+    void Grow();
+    void Shrink();
+    void StartLoop(Member *member);
+    void RetireLoop(Member *member, bool close);
+    void LoopFunc(Member *member);
+    void Dispatch(std::unique_ptr<Connection> connection, Member *to);
+    Member * FreeMember();
+    Member * NextActive();
+
+    Options options_;
+    Emigrate emigrate_;
+    Immigrate immigrate_;
+    std::atomic<std::size_t> active_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stop_;
+    bool closing_;
+    std::size_t next_;
+    std::size_t high_intervals_;
+    std::size_t low_intervals_;
+    std::vector<std::unique_ptr<Member>> members_;
+    std::thread thread_;
+};
+
+} // namespace snet
+
+#endif // EVENT_LOOP_POOL_H
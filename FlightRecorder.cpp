@@ -0,0 +1,340 @@
+#include "FlightRecorder.h"
+#include "LoopMonitor.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+
+namespace
+{
+
+const char kMagic[8] = { 'S', 'N', 'E', 'T', 'F', 'R', '1', '\0' };
+
+std::atomic<std::size_t> ring_capacity(snet::FlightRecorder::kDefaultCapacity);
+
+template<typename T>
+bool WriteValue(FILE *file, const T &value)
+{
+    return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+template<typename T>
+bool ReadValue(FILE *file, T *value)
+{
+    return fread(value, sizeof(*value), 1, file) == 1;
+}
+
+void AppendFormat(std::string *out, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+void AppendFormat(std::string *out, const char *format, ...)
+{
+    char buffer[256];
+
+    va_list args;
+    va_start(args, format);
+    auto len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (len > 0)
+        out->append(buffer, std::min(static_cast<std::size_t>(len),
+                                     sizeof(buffer) - 1));
+}
+
+} // namespace
+
+namespace snet
+{
+
+struct FlightRecorder::Registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+    uint32_t next_thread = 0;
+};
+
+// Return the ring of thread for reuse when the thread exits.
+struct FlightRecorder::Releaser
+{
+    Ring *ring = nullptr;
+
+    ~Releaser()
+    {
+        if (ring)
+            ring->in_use.store(false, std::memory_order_release);
+    }
+};
+
+thread_local FlightRecorder::Ring *FlightRecorder::ring_ = nullptr;
+thread_local FlightRecorder::Releaser FlightRecorder::releaser_;
+
+const char * TraceEventName(TraceEvent event)
+{
+    switch (event)
+    {
+    case TraceEvent::WaitBegin:
+    case TraceEvent::WaitEnd:
+        return "wait";
+    case TraceEvent::FdReady:
+        return "ready";
+    case TraceEvent::CallbackBegin:
+    case TraceEvent::CallbackEnd:
+        return "callback";
+    case TraceEvent::TimerFired:
+        return "timer";
+    case TraceEvent::ConnectionAccepted:
+        return "accepted";
+    case TraceEvent::ConnectionClosed:
+        return "closed";
+    case TraceEvent::BytesSent:
+        return "sent";
+    case TraceEvent::BytesReceived:
+        return "received";
+    }
+
+    return "unknown";
+}
+
+FlightRecorder::Ring::Ring(uint32_t t, std::size_t capacity)
+    : thread(t),
+      in_use(true),
+      mask_(capacity - 1),
+      slots_(new Slot[capacity]),
+      reserved_(0),
+      committed_(0)
+{
+}
+
+void FlightRecorder::Ring::Read(ThreadTrace *trace) const
+{
+    uint64_t capacity = mask_ + 1;
+    auto end = committed_.load(std::memory_order_acquire);
+    auto begin = end > capacity ? end - capacity : 0;
+
+    std::vector<TraceRecord> records;
+    records.reserve(end - begin);
+
+    for (auto i = begin; i < end; ++i)
+    {
+        auto &slot = slots_[i & mask_];
+        auto data = slot.data.load(std::memory_order_relaxed);
+
+        TraceRecord record;
+        record.tsc = slot.tsc.load(std::memory_order_relaxed);
+        record.fd = static_cast<int32_t>(data >> 32);
+        record.event_value = static_cast<uint32_t>(data);
+        records.push_back(record);
+    }
+
+    // Records reserved by the writer while reading may be overwritten.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto reserved = reserved_.load(std::memory_order_relaxed);
+    auto valid = reserved > capacity ? reserved - capacity : 0;
+
+    trace->thread = thread;
+    if (valid > begin)
+    {
+        auto dropped = std::min(valid - begin, end - begin);
+        records.erase(records.begin(), records.begin() + dropped);
+    }
+
+    trace->records = std::move(records);
+}
+
+void FlightRecorder::SetRingCapacity(std::size_t capacity)
+{
+    std::size_t power = 1;
+    while (power < capacity)
+        power <<= 1;
+    ring_capacity = power;
+}
+
+FlightRecorder::Ring * FlightRecorder::AttachRing()
+{
+    auto &registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    Ring *ring = nullptr;
+    for (auto &r : registry.rings)
+    {
+        if (!r->in_use.load(std::memory_order_acquire))
+        {
+            ring = r.get();
+            ring->in_use = true;
+            ring->thread = registry.next_thread++;
+            break;
+        }
+    }
+
+    if (!ring)
+    {
+        registry.rings.emplace_back(
+            new Ring(registry.next_thread++, ring_capacity));
+        ring = registry.rings.back().get();
+    }
+
+    ring_ = ring;
+    releaser_.ring = ring;
+    return ring;
+}
+
+FlightRecorder::Registry & FlightRecorder::GetRegistry()
+{
+    // Rings are never freed, threads may record at process exit.
+    static auto registry = new Registry;
+    return *registry;
+}
+
+FlightSnapshot FlightRecorder::Snapshot()
+{
+    FlightSnapshot snapshot;
+    snapshot.ns_per_tick = TscNanosecondsPerTick();
+
+    auto &registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for (auto &ring : registry.rings)
+    {
+        ThreadTrace trace;
+        ring->Read(&trace);
+        if (!trace.records.empty())
+            snapshot.threads.push_back(std::move(trace));
+    }
+
+    return snapshot;
+}
+
+bool FlightRecorder::WriteSnapshot(const std::string &path)
+{
+    auto snapshot = Snapshot();
+
+    auto file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    auto ok = fwrite(kMagic, sizeof(kMagic), 1, file) == 1 &&
+        WriteValue(file, snapshot.ns_per_tick) &&
+        WriteValue(file, static_cast<uint32_t>(snapshot.threads.size()));
+
+    for (auto &trace : snapshot.threads)
+    {
+        if (!ok)
+            break;
+
+        auto count = static_cast<uint32_t>(trace.records.size());
+        ok = WriteValue(file, trace.thread) && WriteValue(file, count) &&
+            fwrite(trace.records.data(), sizeof(TraceRecord),
+                   count, file) == count;
+    }
+
+    return fclose(file) == 0 && ok;
+}
+
+bool FlightRecorder::ReadSnapshot(const std::string &path,
+                                  FlightSnapshot *snapshot)
+{
+    auto file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    char magic[sizeof(kMagic)];
+    uint32_t threads = 0;
+
+    auto ok = fread(magic, sizeof(magic), 1, file) == 1 &&
+        memcmp(magic, kMagic, sizeof(kMagic)) == 0 &&
+        ReadValue(file, &snapshot->ns_per_tick) &&
+        ReadValue(file, &threads);
+
+    snapshot->threads.clear();
+    for (uint32_t i = 0; ok && i < threads; ++i)
+    {
+        ThreadTrace trace;
+        uint32_t count = 0;
+
+        ok = ReadValue(file, &trace.thread) && ReadValue(file, &count);
+        if (!ok)
+            break;
+
+        trace.records.resize(count);
+        ok = fread(trace.records.data(), sizeof(TraceRecord),
+                   count, file) == count;
+        snapshot->threads.push_back(std::move(trace));
+    }
+
+    fclose(file);
+    return ok;
+}
+
+std::string FlightRecorder::ToChromeTrace(const FlightSnapshot &snapshot)
+{
+    uint64_t base = ~uint64_t(0);
+    for (auto &trace : snapshot.threads)
+    {
+        for (auto &record : trace.records)
+            base = std::min(base, record.tsc);
+    }
+
+    std::string out("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    auto first = true;
+
+    for (auto &trace : snapshot.threads)
+    {
+        if (!first)
+            out += ',';
+        first = false;
+
+        AppendFormat(&out, "{\"name\":\"thread_name\",\"ph\":\"M\","
+                     "\"pid\":1,\"tid\":%u,\"args\":{\"name\":"
+                     "\"snet thread %u\"}}", trace.thread, trace.thread);
+
+        // Ring may begin in the middle of a duration, ends without
+        // begins are dropped.
+        int depth = 0;
+
+        for (auto &record : trace.records)
+        {
+            auto event = record.Event();
+            auto value = record.Value();
+            auto ts = (record.tsc - base) * snapshot.ns_per_tick / 1000.0;
+
+            switch (event)
+            {
+            case TraceEvent::WaitBegin:
+            case TraceEvent::CallbackBegin:
+                ++depth;
+                AppendFormat(&out, ",{\"name\":\"%s\",\"ph\":\"B\","
+                             "\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                             "\"args\":{\"fd\":%d,\"value\":%u}}",
+                             event == TraceEvent::WaitBegin ? "wait" :
+                             CallbackSiteName(
+                                 static_cast<CallbackSite>(value)),
+                             ts, trace.thread, record.fd, value);
+                break;
+
+            case TraceEvent::WaitEnd:
+            case TraceEvent::CallbackEnd:
+                if (depth == 0)
+                    break;
+                --depth;
+                AppendFormat(&out, ",{\"ph\":\"E\",\"ts\":%.3f,"
+                             "\"pid\":1,\"tid\":%u,\"args\":{\"value\":%u}}",
+                             ts, trace.thread, value);
+                break;
+
+            default:
+                AppendFormat(&out, ",{\"name\":\"%s\",\"ph\":\"i\","
+                             "\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                             "\"args\":{\"fd\":%d,\"value\":%u}}",
+                             TraceEventName(event), ts, trace.thread,
+                             record.fd, value);
+                break;
+            }
+        }
+    }
+
+    out += "]}\n";
+    return out;
+}
+
+} // namespace snet
@@ -0,0 +1,171 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include "Tsc.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Trace points record only when compiled with SNET_FLIGHT_RECORDER,
+// otherwise they are compiled out.
+#ifdef SNET_FLIGHT_RECORDER
+#define SNET_TRACE(event, fd, value)                                      \
+    ::snet::FlightRecorder::Record(::snet::TraceEvent::event, (fd), (value))
+#else
+#define SNET_TRACE(event, fd, value) do { } while (0)
+#endif
+
+namespace snet
+{
+
+enum class TraceEvent : uint8_t
+{
+    // Value is the timeout of wait in milliseconds.
+    WaitBegin,
+    // Value is the number of ready events.
+    WaitEnd,
+    // Value is the ready events of fd.
+    FdReady,
+    // Value is the CallbackSite.
+    CallbackBegin,
+    CallbackEnd,
+    // Value is the lateness of the timer in microseconds.
+    TimerFired,
+    ConnectionAccepted,
+    ConnectionClosed,
+    // Value is the number of bytes.
+    BytesSent,
+    BytesReceived
+};
+
+const char * TraceEventName(TraceEvent event);
+
+struct TraceRecord
+{
+    uint64_t tsc;
+    int32_t fd;
+    // Event in the highest 8 bits, value saturated to the low 24 bits.
+    uint32_t event_value;
+
+    TraceEvent Event() const
+    {
+        return static_cast<TraceEvent>(event_value >> 24);
+    }
+
+    uint32_t Value() const
+    {
+        return event_value & 0xFFFFFF;
+    }
+};
+
+struct ThreadTrace
+{
+    uint32_t thread;
+    std::vector<TraceRecord> records;
+};
+
+struct FlightSnapshot
+{
+    double ns_per_tick;
+    std::vector<ThreadTrace> threads;
+};
+
+// Keep the latest trace records of each thread in a ring of the thread.
+// Recording is lock-free and only touches the ring of current thread,
+// snapshot could be taken by any thread at any time. Rings of exited
+// threads are reused by new threads.
+class FlightRecorder final
+{
+public:
+    static const std::size_t kDefaultCapacity = 1 << 16;
+
+    // Capacity of rings created later, rounded up to power of 2.
+    static void SetRingCapacity(std::size_t capacity);
+
+    static void Record(TraceEvent event, int fd, uint64_t value);
+
+    static FlightSnapshot Snapshot();
+
+    // Binary snapshot in native byte order, snet_flight_dump converts it
+    // into Chrome trace JSON.
+    static bool WriteSnapshot(const std::string &path);
+    static bool ReadSnapshot(const std::string &path,
+                             FlightSnapshot *snapshot);
+
+    // Trace event format of Chrome and Perfetto.
+    static std::string ToChromeTrace(const FlightSnapshot &snapshot);
+
+private:
+    class Ring;
+    struct Registry;
+    struct Releaser;
+
+    static Ring * AttachRing();
+    static Registry & GetRegistry();
+
+    static thread_local Ring *ring_;
+    static thread_local Releaser releaser_;
+};
+
+class FlightRecorder::Ring final
+{
+public:
+    Ring(uint32_t thread, std::size_t capacity);
+
+    Ring(const Ring &) = delete;
+    void operator = (const Ring &) = delete;
+
+    // Reserved is published before the slot is overwritten, and committed
+    // after it is written, so readers could drop overwritten records.
+    void Push(uint64_t tsc, uint64_t data)
+    {
+        auto index = committed_.load(std::memory_order_relaxed);
+        auto &slot = slots_[index & mask_];
+
+        reserved_.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.tsc.store(tsc, std::memory_order_relaxed);
+        slot.data.store(data, std::memory_order_relaxed);
+        committed_.store(index + 1, std::memory_order_release);
+    }
+
+    void Read(ThreadTrace *trace) const;
+
+    uint32_t thread;
+    std::atomic<bool> in_use;
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> tsc;
+        std::atomic<uint64_t> data;
+    };
+
+    std::size_t mask_;
+    std::unique_ptr<Slot []> slots_;
+    std::atomic<uint64_t> reserved_;
+    std::atomic<uint64_t> committed_;
+};
+
+inline void FlightRecorder::Record(TraceEvent event, int fd, uint64_t value)
+{
+    auto ring = ring_;
+    if (!ring)
+        ring = AttachRing();
+
+    if (value > 0xFFFFFF)
+        value = 0xFFFFFF;
+
+    auto event_value = (static_cast<uint32_t>(event) << 24) |
+        static_cast<uint32_t>(value);
+    ring->Push(ReadTsc(), (static_cast<uint64_t>(
+                static_cast<uint32_t>(fd)) << 32) | event_value);
+}
+
+} // namespace snet
+
+#endif // FLIGHT_RECORDER_H
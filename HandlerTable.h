@@ -0,0 +1,146 @@
+#ifndef HANDLER_TABLE_H
+#define HANDLER_TABLE_H
+
+#include "EventLoop.h"
+#include <stdint.h>
+#include <vector>
+
+namespace snet
+{
+
+// Event handlers indexed by fd. Each slot has a generation which changes
+// when a handler is added to or deleted from it, the kernel carries the
+// key of fd and generation with events, so the events of deleted handlers
+// or of reused fds are recognized and dropped in O(1).
+//
+// Slot also keeps the events registered in the kernel, updates of events
+// are marked pending and applied by the event loop before next wait, so
+// the updates in one iteration are coalesced and no-op ones are skipped.
+class HandlerTable final
+{
+public:
+    HandlerTable() { }
+
+    HandlerTable(const HandlerTable &) = delete;
+    void operator = (const HandlerTable &) = delete;
+
+    // Events of the handler which are not registered in the kernel.
+    static const int kUnregistered = -1;
+
+    // Return the key of the new handler of fd.
+    uint64_t Add(int fd, EventHandler *eh, int registered)
+    {
+        if (fd < 0)
+            return 0;
+
+        if (static_cast<std::size_t>(fd) >= slots_.size())
+            slots_.resize(fd + 1);
+
+        auto &slot = slots_[fd];
+        slot.eh = eh;
+        ++slot.generation;
+        slot.registered = static_cast<signed char>(registered);
+        slot.pending = false;
+        return MakeKey(fd, slot.generation);
+    }
+
+    // Return the registered events of the deleted handler.
+    int Del(int fd)
+    {
+        if (fd < 0 || static_cast<std::size_t>(fd) >= slots_.size())
+            return kUnregistered;
+
+        auto &slot = slots_[fd];
+        auto registered = slot.registered;
+
+        slot.eh = nullptr;
+        ++slot.generation;
+        slot.registered = kUnregistered;
+        slot.pending = false;
+        return registered;
+    }
+
+    void MarkPending(int fd)
+    {
+        if (fd < 0 || static_cast<std::size_t>(fd) >= slots_.size())
+            return ;
+
+        auto &slot = slots_[fd];
+        if (slot.eh && !slot.pending)
+        {
+            slot.pending = true;
+            pending_.push_back(fd);
+        }
+    }
+
+    bool HasPending() const
+    {
+        return !pending_.empty();
+    }
+
+    // Call apply(fd, key, eh, registered) for each pending handler, apply
+    // returns the events registered after it.
+    template<typename Apply>
+    void ApplyPending(const Apply &apply)
+    {
+        for (auto fd : pending_)
+        {
+            auto &slot = slots_[fd];
+            if (!slot.pending)
+                continue;
+
+            slot.pending = false;
+            slot.registered = static_cast<signed char>(
+                apply(fd, MakeKey(fd, slot.generation),
+                      slot.eh, slot.registered));
+        }
+
+        pending_.clear();
+    }
+
+    // Return the handler of key, or nullptr when it has been deleted.
+    EventHandler * Find(uint64_t key) const
+    {
+        auto fd = static_cast<uint32_t>(key);
+        auto generation = static_cast<uint32_t>(key >> 32);
+
+        if (fd >= slots_.size())
+            return nullptr;
+
+        auto &slot = slots_[fd];
+        if (slot.generation != generation)
+            return nullptr;
+        return slot.eh;
+    }
+
+private:
+    struct Slot
+    {
+        EventHandler *eh;
+        uint32_t generation;
+        // Events are a small mask, keep the slot in 16 bytes.
+        signed char registered;
+        bool pending;
+
+        Slot()
+            : eh(nullptr),
+              generation(0),
+              registered(kUnregistered),
+              pending(false)
+        {
+        }
+    };
+
+    static uint64_t MakeKey(int fd, uint32_t generation)
+    {
+        return (static_cast<uint64_t>(generation) << 32) |
+            static_cast<uint32_t>(fd);
+    }
+
+    std::vector<Slot> slots_;
+    std::vector<int> pending_;
+};
+
+} // namespace snet
+
+#endif // HANDLER_TABLE_H
@@ -1,37 +1,259 @@
 #ifndef KQUEUE_H
 #define KQUEUE_H
 
+#include "EventDispatcher.h"
 #include "EventLoop.h"
+#include "HandlerTable.h"
+#include "LoopMonitor.h"
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <chrono>
 #include <memory>
-
-struct kevent;
+#include <vector>
 
 namespace snet
 {
 
-class KQueue final : public EventLoop
+// Event loop of kqueue, Dispatcher decides which handler types are called
+// without virtual functions. Use it through EventLoop as usual, or use
+// the concrete type directly to avoid virtual calls to the loop.
+// Updates of events are collected into the changelist and submitted with
+// next wait, filters whose state is not changed are skipped.
+template<typename Dispatcher>
+class BasicKQueue final : public EventLoop
 {
 public:
-    KQueue();
-    ~KQueue();
+    BasicKQueue()
+        : stop_(false),
+          kqueue_fd_(kqueue()),
+          events_(new struct kevent[kMaxEvents])
+    {
+    }
+
+    ~BasicKQueue()
+    {
+        if (kqueue_fd_ >= 0)
+            close(kqueue_fd_);
+    }
+
+    virtual void AddEventHandler(EventHandler *eh) override
+    {
+        // Filters are added with the updates before next wait
+        auto fd = Dispatcher::Fd(eh);
+        handlers_.Add(fd, eh, HandlerTable::kUnregistered);
+        handlers_.MarkPending(fd);
+        Counters().handlers.Add(1);
+    }
+
+    virtual void DelEventHandler(EventHandler *eh) override
+    {
+        struct kevent kev[2];
+        int kevc = 0;
+
+        auto fd = Dispatcher::Fd(eh);
+        auto events = static_cast<int>(Dispatcher::Events(eh));
+
+        Counters().handlers.Sub(1);
+
+        // Pending events of the handler are dropped by the generation.
+        if (handlers_.Del(fd) == HandlerTable::kUnregistered)
+            return ;
+
+        if (events & static_cast<int>(Event::Read))
+        {
+            EV_SET(&kev[kevc], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+            ++kevc;
+        }
+
+        if (events & static_cast<int>(Event::Write))
+        {
+            EV_SET(&kev[kevc], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+            ++kevc;
+        }
+
+        if (kevc != 0)
+        {
+            kevent(kqueue_fd_, kev, kevc, nullptr, 0, nullptr);
+            Counters().ctl_calls.Add(kevc);
+        }
+    }
+
+    virtual void UpdateEvents(EventHandler *eh) override
+    {
+        handlers_.MarkPending(Dispatcher::Fd(eh));
+    }
+
+    virtual void AddLoopHandler(LoopHandler *lh) override
+    {
+        lh_set_.AddLoopHandler(lh);
+    }
+
+    virtual void DelLoopHandler(LoopHandler *lh) override
+    {
+        lh_set_.DelLoopHandler(lh);
+    }
+
+    virtual void Loop() override
+    {
+        using Clock = std::chrono::steady_clock;
+
+        auto &counters = Counters();
+        auto busy_begin = Clock::now();
+
+        while (!stop_)
+        {
+            auto monitor = Monitor();
+
+            struct timespec ts;
+            ts.tv_sec = 0;
+            ts.tv_nsec = lh_set_.HasPendingWork() ? 0 : 20 * 1000 * 1000;
+
+            if (handlers_.HasPending())
+                CollectChanges();
+
+            counters.ctl_calls.Add(changes_.size());
+
+            SNET_TRACE(WaitBegin, -1, ts.tv_nsec / 1000000);
+            auto wait_begin = Clock::now();
+            auto kevc = kevent(kqueue_fd_, changes_.data(),
+                               static_cast<int>(changes_.size()),
+                               events_.get(), kMaxEvents, &ts);
+            auto wait_end = Clock::now();
+            SNET_TRACE(WaitEnd, -1, kevc > 0 ? kevc : 0);
+            changes_.clear();
+
+            counters.busy_ns.Add(ToNanoseconds(wait_begin - busy_begin));
+            counters.blocked_ns.Add(ToNanoseconds(wait_end - wait_begin));
+            busy_begin = wait_end;
 
-    virtual void AddEventHandler(EventHandler *eh) override;
-    virtual void DelEventHandler(EventHandler *eh) override;
-    virtual void UpdateEvents(EventHandler *eh) override;
-    virtual void AddLoopHandler(LoopHandler *lh) override;
-    virtual void DelLoopHandler(LoopHandler *lh) override;
-    virtual void Loop() override;
-    virtual void Stop() override;
+            if (monitor)
+                monitor->BeginIteration();
+
+            uint64_t callbacks = 0;
+            for (int i = 0; i < kevc; ++i)
+            {
+                // Error of a change in the changelist
+                if (events_[i].flags & EV_ERROR)
+                    continue;
+
+                auto eh = handlers_.Find(UDataToKey(events_[i].udata));
+                auto fd = static_cast<int>(events_[i].ident);
+                SNET_TRACE(FdReady, fd,
+                           static_cast<uint16_t>(events_[i].filter));
+
+                if (eh)
+                {
+                    switch (events_[i].filter)
+                    {
+                    case EVFILT_READ:
+                    {
+                        CallbackScope scope(monitor, CallbackSite::Read,
+                                            eh, fd);
+                        Dispatcher::HandleRead(eh);
+                        ++callbacks;
+                        break;
+                    }
+
+                    case EVFILT_WRITE:
+                    {
+                        CallbackScope scope(monitor, CallbackSite::Write,
+                                            eh, fd);
+                        Dispatcher::HandleWrite(eh);
+                        ++callbacks;
+                        break;
+                    }
+                    }
+                }
+            }
+
+            counters.iterations.Add(1);
+            counters.events.Add(kevc > 0 ? kevc : 0);
+            counters.callbacks.Add(callbacks);
+
+            lh_set_.HandleLoop(monitor);
+
+            if (monitor)
+                monitor->EndIteration();
+        }
+
+        counters.busy_ns.Add(ToNanoseconds(Clock::now() - busy_begin));
+        lh_set_.HandleStop();
+    }
+
+    virtual void Stop() override
+    {
+        stop_ = true;
+    }
 
 private:
-    static const int kMaxEvents = 10;
+    void CollectChanges()
+    {
+        handlers_.ApplyPending(
+            [this] (int fd, uint64_t key, EventHandler *eh, int registered) {
+                auto events = static_cast<int>(Dispatcher::Events(eh));
+                auto enabled = static_cast<int>(Dispatcher::EnabledEvents(eh));
+
+                if (events & static_cast<int>(Event::Read))
+                    AddChange(fd, EVFILT_READ, key, registered, enabled,
+                              static_cast<int>(Event::Read));
+
+                if (events & static_cast<int>(Event::Write))
+                    AddChange(fd, EVFILT_WRITE, key, registered, enabled,
+                              static_cast<int>(Event::Write));
+
+                return enabled;
+            });
+    }
+
+    void AddChange(int fd, int16_t filter, uint64_t key,
+                   int registered, int enabled, int event)
+    {
+        if (registered != HandlerTable::kUnregistered &&
+            (registered & event) == (enabled & event))
+            return ;
+
+        auto flags = (enabled & event) ?
+            EV_ADD | EV_ENABLE : EV_ADD | EV_DISABLE;
+
+        struct kevent kev;
+        EV_SET(&kev, fd, filter, flags, 0, 0, KeyToUData(key));
+        changes_.push_back(kev);
+    }
+
+    template<typename Duration>
+    static uint64_t ToNanoseconds(const Duration &duration)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            duration).count();
+    }
+
+    static_assert(sizeof(void *) >= sizeof(uint64_t),
+                  "Key of handler does not fit in udata");
+
+    static void * KeyToUData(uint64_t key)
+    {
+        return reinterpret_cast<void *>(static_cast<uintptr_t>(key));
+    }
+
+    static uint64_t UDataToKey(void *udata)
+    {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(udata));
+    }
+
+    static const int kMaxEvents = 256;
 
     bool stop_;
     int kqueue_fd_;
+    HandlerTable handlers_;
     LoopHandlerSet lh_set_;
+    std::vector<struct kevent> changes_;
     std::unique_ptr<struct kevent []> events_;
 };
 
+using KQueue = BasicKQueue<DefaultEventDispatcher>;
+
 } // namespace snet
 
 #endif // KQUEUE_H
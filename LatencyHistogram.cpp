@@ -0,0 +1,42 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace snet
+{
+
+uint64_t LatencyHistogram::Percentile(double percentile) const
+{
+    auto count = Count();
+    if (count == 0)
+        return 0;
+
+    auto rank = static_cast<uint64_t>(std::ceil(count * percentile / 100.0));
+    if (rank == 0)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i)
+    {
+        seen += counts_[i].Get();
+        if (seen >= rank)
+            return std::min(BucketUpperBound(i), Max());
+    }
+
+    // Buckets are read while they are recorded.
+    return Max();
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(std::size_t index)
+{
+    auto group = index / kSubBuckets;
+    auto sub = index % kSubBuckets;
+
+    if (group == 0)
+        return sub;
+
+    auto lower = (kSubBuckets + sub) << (group - 1);
+    return lower + (1ull << (group - 1)) - 1;
+}
+
+} // namespace snet
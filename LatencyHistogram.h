@@ -0,0 +1,76 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include "LoopStats.h"
+#include <cstddef>
+#include <stdint.h>
+
+namespace snet
+{
+
+// Log-linear histogram of latencies in nanoseconds like HdrHistogram,
+// values keep 1/32 relative precision up to 2^40 ns. Record is called by
+// one thread, and other threads could read it at the same time.
+class LatencyHistogram final
+{
+public:
+    LatencyHistogram() { }
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    void operator = (const LatencyHistogram &) = delete;
+
+    void Record(uint64_t ns)
+    {
+        counts_[BucketIndex(ns)].Add(1);
+        count_.Add(1);
+
+        if (ns > max_.Get())
+            max_.Set(ns);
+    }
+
+    uint64_t Count() const
+    {
+        return count_.Get();
+    }
+
+    uint64_t Max() const
+    {
+        return max_.Get();
+    }
+
+    // Return the upper bound of the bucket which holds the percentile,
+    // percentile is in [0, 100].
+    uint64_t Percentile(double percentile) const;
+
+private:
+    static const int kSubBucketBits = 5;
+    static const int kMaxBits = 40;
+    static const uint64_t kSubBuckets = 1ull << kSubBucketBits;
+    static const std::size_t kBuckets =
+        (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+    static std::size_t BucketIndex(uint64_t value)
+    {
+        if (value < kSubBuckets)
+            return static_cast<std::size_t>(value);
+
+        if (value >= (1ull << kMaxBits))
+            value = (1ull << kMaxBits) - 1;
+
+        // Top kSubBucketBits bits below the highest bit select the
+        // bucket in the group of the highest bit.
+        auto shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+        auto sub = (value >> shift) - kSubBuckets;
+        return static_cast<std::size_t>((shift + 1) * kSubBuckets + sub);
+    }
+
+    static uint64_t BucketUpperBound(std::size_t index);
+
+    LoopCounter counts_[kBuckets];
+    LoopCounter count_;
+    LoopCounter max_;
+};
+
+} // namespace snet
+
+#endif // LATENCY_HISTOGRAM_H
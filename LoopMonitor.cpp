@@ -0,0 +1,37 @@
+#include "LoopMonitor.h"
+
+namespace snet
+{
+
+const char * CallbackSiteName(CallbackSite site)
+{
+    switch (site)
+    {
+    case CallbackSite::Read:
+        return "read";
+    case CallbackSite::Write:
+        return "write";
+    case CallbackSite::Error:
+        return "error";
+    case CallbackSite::Loop:
+        return "loop";
+    case CallbackSite::Timer:
+        return "timer";
+    case CallbackSite::None:
+        break;
+    }
+
+    return "none";
+}
+
+LoopMonitor::LoopMonitor()
+    : ns_per_tick_(TscNanosecondsPerTick()),
+      iteration_(0),
+      busy_since_(0),
+      site_(static_cast<int>(CallbackSite::None)),
+      handler_(nullptr),
+      fd_(-1)
+{
+}
+
+} // namespace snet
@@ -0,0 +1,139 @@
+#ifndef LOOP_MONITOR_H
+#define LOOP_MONITOR_H
+
+#include "FlightRecorder.h"
+#include "LatencyHistogram.h"
+#include "Tsc.h"
+#include <atomic>
+#include <stdint.h>
+
+namespace snet
+{
+
+enum class CallbackSite : int
+{
+    Read,
+    Write,
+    Error,
+    // HandleLoop of loop handlers, including the timers they fire.
+    Loop,
+    Timer,
+    None
+};
+
+const int kCallbackSites = static_cast<int>(CallbackSite::None);
+
+const char * CallbackSiteName(CallbackSite site);
+
+// Instrumentation of an event loop, set by EventLoop::SetMonitor before
+// the loop runs. The loop times each callback into the histogram of its
+// site, and publishes the iteration and callback being run, so Watchdog
+// could find the stalled loops.
+class LoopMonitor final
+{
+public:
+    LoopMonitor();
+
+    LoopMonitor(const LoopMonitor &) = delete;
+    void operator = (const LoopMonitor &) = delete;
+
+    // Histograms could be read from any thread.
+    const LatencyHistogram & Histogram(CallbackSite site) const
+    {
+        return histograms_[static_cast<int>(site)];
+    }
+
+    // Event loop begins an iteration when the wait returns, and ends it
+    // before next wait.
+    void BeginIteration()
+    {
+        iteration_.store(iteration_.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+        busy_since_.store(ReadTsc(), std::memory_order_relaxed);
+    }
+
+    void EndIteration()
+    {
+        busy_since_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    friend class CallbackScope;
+    friend class Watchdog;
+
+    double ns_per_tick_;
+    std::atomic<uint64_t> iteration_;
+    std::atomic<uint64_t> busy_since_;
+    std::atomic<int> site_;
+    std::atomic<const void *> handler_;
+    std::atomic<int> fd_;
+    LatencyHistogram histograms_[kCallbackSites];
+};
+
+// Time a callback of the loop of monitor in the scope, it is not timed
+// when monitor is nullptr. Scopes could be nested, the outer callback is
+// published again when the inner one ends. The callback is also traced
+// by the flight recorder when it is compiled in.
+class CallbackScope final
+{
+public:
+    CallbackScope(LoopMonitor *monitor, CallbackSite site,
+                  const void *handler, int fd)
+        : monitor_(monitor),
+          site_(site),
+          fd_(fd)
+    {
+        SNET_TRACE(CallbackBegin, fd_, static_cast<uint32_t>(site_));
+
+        if (monitor_)
+            Begin(handler);
+    }
+
+    ~CallbackScope()
+    {
+        if (monitor_)
+            End();
+
+        SNET_TRACE(CallbackEnd, fd_, static_cast<uint32_t>(site_));
+    }
+
+    CallbackScope(const CallbackScope &) = delete;
+    void operator = (const CallbackScope &) = delete;
+
+private:
+    void Begin(const void *handler)
+    {
+        prev_site_ = monitor_->site_.load(std::memory_order_relaxed);
+        prev_handler_ = monitor_->handler_.load(std::memory_order_relaxed);
+        prev_fd_ = monitor_->fd_.load(std::memory_order_relaxed);
+
+        monitor_->site_.store(static_cast<int>(site_),
+                              std::memory_order_relaxed);
+        monitor_->handler_.store(handler, std::memory_order_relaxed);
+        monitor_->fd_.store(fd_, std::memory_order_relaxed);
+        begin_ = ReadTsc();
+    }
+
+    void End()
+    {
+        auto ticks = ReadTsc() - begin_;
+        monitor_->histograms_[static_cast<int>(site_)].Record(
+            static_cast<uint64_t>(ticks * monitor_->ns_per_tick_));
+
+        monitor_->site_.store(prev_site_, std::memory_order_relaxed);
+        monitor_->handler_.store(prev_handler_, std::memory_order_relaxed);
+        monitor_->fd_.store(prev_fd_, std::memory_order_relaxed);
+    }
+
+    LoopMonitor *monitor_;
+    CallbackSite site_;
+    int fd_;
+    uint64_t begin_;
+    int prev_site_;
+    const void *prev_handler_;
+    int prev_fd_;
+};
+
+} // namespace snet
+
+#endif // LOOP_MONITOR_H
@@ -0,0 +1,113 @@
+#ifndef LOOP_STATS_H
+#define LOOP_STATS_H
+
+#include <atomic>
+#include <stdint.h>
+
+namespace snet
+{
+
+// Snapshot of the counters of an event loop.
+struct LoopStats
+{
+    uint64_t iterations = 0;
+    // Ready events returned by waits, events / iterations is the events
+    // per wait.
+    uint64_t events = 0;
+    uint64_t blocked_ns = 0;
+    uint64_t busy_ns = 0;
+    // Calls of handlers of read, write and error events.
+    uint64_t callbacks = 0;
+    // epoll_ctl calls, or changes submitted to kevent.
+    uint64_t ctl_calls = 0;
+    uint64_t handlers = 0;
+    // Timers of the TimerDrivers attributed to the loop.
+    uint64_t timers_pending = 0;
+    uint64_t late_timers = 0;
+    // Traffic of the connections with stats enabled.
+    uint64_t bytes_sent = 0;
+    uint64_t bytes_received = 0;
+    uint64_t messages_sent = 0;
+    uint64_t messages_received = 0;
+    uint64_t send_blocked_ns = 0;
+};
+
+// Counter updated only by the thread of its event loop and read by any
+// thread, so it is updated by relaxed load and store instead of atomic
+// read-modify-write.
+class LoopCounter final
+{
+public:
+    LoopCounter()
+        : value_(0)
+    {
+    }
+
+    LoopCounter(const LoopCounter &) = delete;
+    void operator = (const LoopCounter &) = delete;
+
+    void Add(uint64_t value)
+    {
+        Set(Get() + value);
+    }
+
+    void Sub(uint64_t value)
+    {
+        Set(Get() - value);
+    }
+
+    void Set(uint64_t value)
+    {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    uint64_t Get() const
+    {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> value_;
+};
+
+struct LoopCounters
+{
+    LoopCounter iterations;
+    LoopCounter events;
+    LoopCounter blocked_ns;
+    LoopCounter busy_ns;
+    LoopCounter callbacks;
+    LoopCounter ctl_calls;
+    LoopCounter handlers;
+    LoopCounter timers_pending;
+    LoopCounter late_timers;
+    LoopCounter bytes_sent;
+    LoopCounter bytes_received;
+    LoopCounter messages_sent;
+    LoopCounter messages_received;
+    LoopCounter send_blocked_ns;
+
+    LoopStats Snapshot() const
+    {
+        LoopStats stats;
+        stats.iterations = iterations.Get();
+        stats.events = events.Get();
+        stats.blocked_ns = blocked_ns.Get();
+        stats.busy_ns = busy_ns.Get();
+        stats.callbacks = callbacks.Get();
+        stats.ctl_calls = ctl_calls.Get();
+        stats.handlers = handlers.Get();
+        stats.timers_pending = timers_pending.Get();
+        stats.late_timers = late_timers.Get();
+        stats.bytes_sent = bytes_sent.Get();
+        stats.bytes_received = bytes_received.Get();
+        stats.messages_sent = messages_sent.Get();
+        stats.messages_received = messages_received.Get();
+        stats.send_blocked_ns = send_blocked_ns.Get();
+        return stats;
+    }
+};
+
+} // namespace snet
+
+#endif // LOOP_STATS_H
@@ -0,0 +1,48 @@
+#include "LoopTasks.h"
+
+namespace snet
+{
+
+LoopTasks::LoopTasks()
+    : pending_(false)
+{
+}
+
+void LoopTasks::Post(Task task)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    pending_.store(true, std::memory_order_relaxed);
+}
+
+void LoopTasks::HandleLoop()
+{
+    if (pending_.load(std::memory_order_relaxed))
+        RunTasks();
+}
+
+void LoopTasks::HandleStop()
+{
+    RunTasks();
+}
+
+bool LoopTasks::HasPendingWork() const
+{
+    return pending_.load(std::memory_order_relaxed);
+}
+
+void LoopTasks::RunTasks()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_.swap(tasks_);
+        pending_.store(false, std::memory_order_relaxed);
+    }
+
+    // Tasks posted by running tasks run in the next iteration.
+    for (auto &task : running_)
+        task();
+    running_.clear();
+}
+
+} // namespace snet
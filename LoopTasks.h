@@ -0,0 +1,43 @@
+#ifndef LOOP_TASKS_H
+#define LOOP_TASKS_H
+
+#include "Delegate.h"
+#include "EventLoop.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace snet
+{
+
+// Run tasks posted by any thread in the thread of an event loop, in the
+// posted order. Add it to the loop, tasks run in the next iteration of
+// the loop, tasks left when the loop stops run in HandleStop.
+class LoopTasks final : public LoopHandler
+{
+public:
+    using Task = Delegate<void ()>;
+
+    LoopTasks();
+
+    LoopTasks(const LoopTasks &) = delete;
+    void operator = (const LoopTasks &) = delete;
+
+    void Post(Task task);
+
+    virtual void HandleLoop() override;
+    virtual void HandleStop() override;
+    virtual bool HasPendingWork() const override;
+
+private:
+    void RunTasks();
+
+    std::mutex mutex_;
+    std::vector<Task> tasks_;
+    std::vector<Task> running_;
+    std::atomic<bool> pending_;
+};
+
+} // namespace snet
+
+#endif // LOOP_TASKS_H
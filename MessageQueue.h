@@ -1,7 +1,7 @@
 #ifndef MESSAGE_QUEUE_H
 #define MESSAGE_QUEUE_H
 
-#include <queue>
+#include <vector>
 #include <mutex>
 #include <memory>
 #include <utility>
@@ -10,60 +10,131 @@
 namespace snet
 {
 
+// Messages are kept in a vector from front_, so the whole queue could be
+// swapped out by DrainInto, and the capacity is reused by the next
+// messages.
 template<typename T>
 class MessageQueue
 {
 public:
     using Type = T;
 
-    MessageQueue() { }
+    MessageQueue() : front_(0), waiters_(0) { }
     MessageQueue(const MessageQueue &) = delete;
     void operator = (const MessageQueue &) = delete;
 
+    // Message is pushed under the mutex, and the condition variable is
+    // notified after unlocking only when some receiver waits in Recv.
     template<typename U>
     void Send(U &&u)
     {
+        bool notify = false;
+
         {
             std::lock_guard<std::mutex> l(mutex_);
-            queue_.push(std::forward<U>(u));
+            queue_.push_back(std::forward<U>(u));
+            notify = waiters_ > 0;
         }
-        cond_var_.notify_one();
+
+        if (notify)
+            cond_var_.notify_one();
     }
 
     T Recv()
     {
-        T t;
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++waiters_;
+        cond_var_.wait(lock, [this] () { return !Empty(); });
+        --waiters_;
+        return Pop();
+    }
 
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
-            cond_var_.wait(lock, [this] () { return !queue_.empty(); });
-            t = std::move(queue_.front());
-            queue_.pop();
-        }
+    // Return false when there is no message.
+    bool TryRecv(T *t)
+    {
+        std::lock_guard<std::mutex> l(mutex_);
+        if (Empty())
+            return false;
 
-        return std::move(t);
+        *t = Pop();
+        return true;
     }
 
+    // Allocate the returned message, prefer TryRecv(T *).
     std::unique_ptr<T> TryRecv()
     {
         std::unique_ptr<T> t;
 
         {
             std::lock_guard<std::mutex> l(mutex_);
-            if (!queue_.empty())
-            {
-                t.reset(new T(std::move(queue_.front())));
-                queue_.pop();
-            }
+            if (!Empty())
+                t.reset(new T(Pop()));
+        }
+
+        return t;
+    }
+
+    // Append all messages to out with one lock, return the number of
+    // messages appended. An empty out is swapped with the queue, pass the
+    // same vector each time to reuse its capacity.
+    std::size_t DrainInto(std::vector<T> *out)
+    {
+        std::lock_guard<std::mutex> l(mutex_);
+        auto count = queue_.size() - front_;
+
+        if (out->empty() && front_ == 0)
+        {
+            out->swap(queue_);
+        }
+        else
+        {
+            for (auto i = front_; i < queue_.size(); ++i)
+                out->push_back(std::move(queue_[i]));
+            queue_.clear();
         }
 
-        return std::move(t);
+        front_ = 0;
+        return count;
+    }
+
+    std::vector<T> TryRecvAll()
+    {
+        std::vector<T> messages;
+        DrainInto(&messages);
+        return messages;
     }
 
 private:
-    std::queue<T> queue_;
+    bool Empty() const
+    {
+        return front_ == queue_.size();
+    }
+
+    // Received messages are dropped when the queue is empty, or when
+    // they are half of a long queue.
+    T Pop()
+    {
+        T t(std::move(queue_[front_++]));
+
+        if (front_ == queue_.size())
+        {
+            queue_.clear();
+            front_ = 0;
+        }
+        else if (front_ >= 64 && front_ * 2 >= queue_.size())
+        {
+            queue_.erase(queue_.begin(), queue_.begin() + front_);
+            front_ = 0;
+        }
+
+        return t;
+    }
+
+    std::vector<T> queue_;
+    std::size_t front_;
     std::mutex mutex_;
     std::condition_variable cond_var_;
+    int waiters_;
 };
 
 } // namespace snet
@@ -0,0 +1,108 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+
+namespace snet
+{
+
+// Base of messages of MpscQueue, a message is linked into the queue by
+// itself, so a message could be in only one queue at a time.
+class MpscNode
+{
+protected:
+    MpscNode() : mpsc_next_(nullptr) { }
+    ~MpscNode() { }
+
+private:
+    template<typename T> friend class MpscQueue;
+
+    std::atomic<MpscNode *> mpsc_next_;
+};
+
+// Lock-free intrusive queue of many producer threads and one consumer
+// thread, messages derive from MpscNode and are owned by the queue while
+// they are queued. Send is wait-free with one exchange and never
+// allocates. TryRecv could miss messages being sent at the same time,
+// they are received by the next TryRecv. It never blocks, use
+// MessageQueue to wait for messages.
+template<typename T>
+class MpscQueue
+{
+public:
+    using Type = T;
+
+    MpscQueue()
+        : head_(&stub_),
+          tail_(&stub_)
+    {
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    void operator = (const MpscQueue &) = delete;
+
+    // Any thread.
+    void Send(T *t)
+    {
+        Push(t);
+    }
+
+    // Consumer thread only, return nullptr when there is no message.
+    T * TryRecv()
+    {
+        auto tail = tail_;
+        auto next = tail->mpsc_next_.load(std::memory_order_acquire);
+
+        if (tail == &stub_)
+        {
+            if (!next)
+                return nullptr;
+
+            tail_ = next;
+            tail = next;
+            next = next->mpsc_next_.load(std::memory_order_acquire);
+        }
+
+        if (next)
+        {
+            tail_ = next;
+            return static_cast<T *>(tail);
+        }
+
+        // Tail is the last message unless a producer has not linked
+        // its message yet, then wait for the next call.
+        if (tail != head_.load(std::memory_order_acquire))
+            return nullptr;
+
+        // Stub keeps the queue non-empty when the last message is taken.
+        Push(&stub_);
+
+        next = tail->mpsc_next_.load(std::memory_order_acquire);
+        if (next)
+        {
+            tail_ = next;
+            return static_cast<T *>(tail);
+        }
+
+        return nullptr;
+    }
+
+private:
+    void Push(MpscNode *node)
+    {
+        node->mpsc_next_.store(nullptr, std::memory_order_relaxed);
+        auto prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->mpsc_next_.store(node, std::memory_order_release);
+    }
+
+    // Padding keeps head of producers and tail of the consumer on
+    // different cache lines.
+    std::atomic<MpscNode *> head_;
+    char padding_[64];
+    MpscNode *tail_;
+    MpscNode stub_;
+};
+
+} // namespace snet
+
+#endif // MPSC_QUEUE_H
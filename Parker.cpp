@@ -0,0 +1,69 @@
+#include "Parker.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace snet
+{
+
+namespace
+{
+
+#ifdef __linux__
+uint32_t * FutexWord(std::atomic<uint32_t> *word)
+{
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                  "futex word must be 32 bits");
+    return reinterpret_cast<uint32_t *>(word);
+}
+#endif
+
+} // namespace
+
+Parker::Parker()
+    : epoch_(0),
+      waiting_(false)
+{
+}
+
+#ifdef __linux__
+
+void Parker::Park(uint32_t epoch)
+{
+    // Return at once when epoch is changed, retry on spurious wakeups.
+    syscall(SYS_futex, FutexWord(&epoch_), FUTEX_WAIT_PRIVATE,
+            epoch, nullptr, nullptr, 0);
+}
+
+void Parker::Unpark()
+{
+    epoch_.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, FutexWord(&epoch_), FUTEX_WAKE_PRIVATE,
+            1, nullptr, nullptr, 0);
+}
+
+#else
+
+void Parker::Park(uint32_t epoch)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_var_.wait(lock, [this, epoch] () {
+        return epoch_.load(std::memory_order_relaxed) != epoch;
+    });
+}
+
+void Parker::Unpark()
+{
+    {
+        std::lock_guard<std::mutex> l(mutex_);
+        epoch_.fetch_add(1, std::memory_order_release);
+    }
+    cond_var_.notify_one();
+}
+
+#endif
+
+} // namespace snet
@@ -0,0 +1,102 @@
+#ifndef PARKER_H
+#define PARKER_H
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+
+#ifndef __linux__
+#include <condition_variable>
+#include <mutex>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace snet
+{
+
+inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Let one thread wait for a condition set by another thread. The waiter
+// spins, then yields, then parks on a futex, or a condition variable on
+// platforms without futex. Notify is a fence and a load unless the
+// waiter is parked, so it is cheap to call after every change.
+class Parker final
+{
+public:
+    static const int kSpins = 128;
+    static const int kYields = 16;
+
+    Parker();
+
+    Parker(const Parker &) = delete;
+    void operator = (const Parker &) = delete;
+
+    // Return when ready returns true, only one thread waits at a time.
+    template<typename Ready>
+    void Wait(Ready ready)
+    {
+        for (int i = 0; i < kSpins; ++i)
+        {
+            if (ready())
+                return ;
+            CpuRelax();
+        }
+
+        for (int i = 0; i < kYields; ++i)
+        {
+            if (ready())
+                return ;
+            std::this_thread::yield();
+        }
+
+        while (true)
+        {
+            // Notifier reads waiting_ after its change, waiter reads the
+            // change after waiting_, so one of them sees the other.
+            auto epoch = epoch_.load(std::memory_order_acquire);
+            waiting_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (ready())
+                break;
+
+            Park(epoch);
+        }
+
+        waiting_.store(false, std::memory_order_relaxed);
+    }
+
+    // Call after the change which makes ready of the waiter true.
+    void Notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_relaxed))
+            Unpark();
+    }
+
+private:
+    void Park(uint32_t epoch);
+    void Unpark();
+
+    std::atomic<uint32_t> epoch_;
+    std::atomic<bool> waiting_;
+
+#ifndef __linux__
+    std::mutex mutex_;
+    std::condition_variable cond_var_;
+#endif
+};
+
+} // namespace snet
+
+#endif // PARKER_H
@@ -0,0 +1,85 @@
+#include "ReadScheduler.h"
+#include "Connection.h"
+
+namespace snet
+{
+
+ReadScheduler::ReadScheduler(std::size_t bytes_per_round,
+                             std::size_t messages_per_round)
+    : bytes_per_round_(bytes_per_round),
+      messages_per_round_(messages_per_round),
+      round_(1),
+      weights_(1, 1),
+      front_slot_(0),
+      parked_count_(0)
+{
+}
+
+int ReadScheduler::AddGroup(unsigned int weight)
+{
+    weights_.push_back(weight > 0 ? weight : 1);
+    return static_cast<int>(weights_.size() - 1);
+}
+
+std::size_t ReadScheduler::GetParkedConnections() const
+{
+    return parked_count_;
+}
+
+void ReadScheduler::HandleLoop()
+{
+    // Connections parked in this round are resumed in the next round,
+    // including the ones parked again while resuming.
+    while (!parked_.empty() && parked_.front().round < round_)
+    {
+        auto connection = parked_.front().connection;
+        parked_.pop_front();
+        ++front_slot_;
+
+        // Connection was unparked by Close or PauseRead.
+        if (connection)
+        {
+            --parked_count_;
+            connection->ResumeParkedRead();
+        }
+    }
+
+    ++round_;
+}
+
+bool ReadScheduler::HasGroup(int group) const
+{
+    return group >= 0 && static_cast<std::size_t>(group) < weights_.size();
+}
+
+uint64_t ReadScheduler::Park(Connection *connection)
+{
+    Parked parked;
+    parked.connection = connection;
+    parked.round = round_;
+    parked_.push_back(parked);
+    ++parked_count_;
+    return front_slot_ + parked_.size() - 1;
+}
+
+void ReadScheduler::Unpark(Connection *connection, uint64_t slot)
+{
+    auto index = slot - front_slot_;
+    if (slot < front_slot_ || index >= parked_.size() ||
+        parked_[index].connection != connection)
+        return ;
+
+    parked_[index].connection = nullptr;
+    --parked_count_;
+
+    // Cleared slots at the ends are dropped at once.
+    while (!parked_.empty() && !parked_.back().connection)
+        parked_.pop_back();
+    while (!parked_.empty() && !parked_.front().connection)
+    {
+        parked_.pop_front();
+        ++front_slot_;
+    }
+}
+
+} // namespace snet
@@ -0,0 +1,89 @@
+#ifndef READ_SCHEDULER_H
+#define READ_SCHEDULER_H
+
+#include "EventLoop.h"
+#include <cstddef>
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+namespace snet
+{
+
+class Connection;
+
+// Bound the bytes and messages each connection reads in one round of an
+// event loop, so a busy connection could not starve others of the loop.
+// A message is one Recv which returns data. Connections join it by
+// Connection::SetReadScheduler. When the budget of a connection is used
+// up, Recv returns RecvE::NoAvailData and the connection is parked, its
+// OnReceivable is called in round-robin order in the next round.
+// Create one for each event loop and add it to the loop.
+class ReadScheduler final : public LoopHandler
+{
+public:
+    // Budgets of weight 1 in a round, 0 means unlimited.
+    ReadScheduler(std::size_t bytes_per_round,
+                  std::size_t messages_per_round);
+
+    ReadScheduler(const ReadScheduler &) = delete;
+    void operator = (const ReadScheduler &) = delete;
+
+    // Group 0 has weight 1. Connections of a group get weight times
+    // the budgets in a round. Return the id of the new group.
+    int AddGroup(unsigned int weight);
+
+    std::size_t GetParkedConnections() const;
+
+    virtual void HandleLoop() override;
+    virtual void HandleStop() override { }
+
+    virtual bool HasPendingWork() const override
+    {
+        return parked_count_ > 0;
+    }
+
+private:
+    friend class Connection;
+
+    struct Parked
+    {
+        Connection *connection;
+        uint64_t round;
+    };
+
+    uint64_t Round() const
+    {
+        return round_;
+    }
+
+    std::size_t ByteBudget(int group) const
+    {
+        return bytes_per_round_ * weights_[group];
+    }
+
+    std::size_t MessageBudget(int group) const
+    {
+        return messages_per_round_ * weights_[group];
+    }
+
+    bool HasGroup(int group) const;
+
+    // Return the slot of the parked connection, Unpark clears the slot in
+    // O(1), the cleared slot is dropped at the latest in the next round.
+    uint64_t Park(Connection *connection);
+    void Unpark(Connection *connection, uint64_t slot);
+
+    std::size_t bytes_per_round_;
+    std::size_t messages_per_round_;
+    uint64_t round_;
+    std::vector<unsigned int> weights_;
+    // Slot of parked_.front() is front_slot_, slots count up from it.
+    std::deque<Parked> parked_;
+    uint64_t front_slot_;
+    std::size_t parked_count_;
+};
+
+} // namespace snet
+
+#endif // READ_SCHEDULER_H
@@ -0,0 +1,172 @@
+#include "Rebalancer.h"
+
+namespace snet
+{
+
+// Task of the idle loop, takes over a detached connection. Connection is
+// closed if the task is dropped without running.
+class Rebalancer::Arrival final
+{
+public:
+    Arrival(Rebalancer *rebalancer, Member *to,
+            std::unique_ptr<Connection> connection)
+        : rebalancer_(rebalancer),
+          to_(to),
+          connection_(std::move(connection))
+    {
+    }
+
+    Arrival(Arrival &&) = default;
+
+    void operator () ()
+    {
+        connection_->Attach(to_->loop, to_->scheduler, to_->budget);
+        to_->immigrate(std::move(connection_));
+
+        ++rebalancer_->moves_;
+        --to_->moving;
+    }
+
+private:
+    Rebalancer *rebalancer_;
+    Member *to_;
+    std::unique_ptr<Connection> connection_;
+};
+
+// Task of the busy loop, gives up connections to the idle loop.
+class Rebalancer::Departure final
+{
+public:
+    Departure(Rebalancer *rebalancer, Member *from, Member *to)
+        : rebalancer_(rebalancer),
+          from_(from),
+          to_(to)
+    {
+    }
+
+    void operator () ()
+    {
+        for (std::size_t i = 0; i < rebalancer_->moves_per_interval_; ++i)
+        {
+            auto connection = from_->emigrate();
+            if (!connection)
+                break;
+
+            connection->Detach();
+            ++to_->moving;
+            to_->tasks->Post(Arrival(rebalancer_, to_, std::move(connection)));
+        }
+
+        --from_->moving;
+        --to_->moving;
+    }
+
+private:
+    Rebalancer *rebalancer_;
+    Member *from_;
+    Member *to_;
+};
+
+Rebalancer::Rebalancer(std::chrono::milliseconds interval, double threshold,
+                       std::size_t moves)
+    : interval_(interval),
+      threshold_(threshold),
+      moves_per_interval_(moves),
+      moves_(0),
+      stop_(false),
+      thread_(&Rebalancer::RebalanceFunc, this)
+{
+}
+
+Rebalancer::~Rebalancer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    cond_.notify_one();
+    thread_.join();
+}
+
+void Rebalancer::AddLoop(EventLoop *loop, LoopTasks *tasks,
+                         Emigrate emigrate, Immigrate immigrate,
+                         ReadScheduler *scheduler, SendQueueBudget *budget)
+{
+    std::unique_ptr<Member> member(new Member);
+    member->loop = loop;
+    member->tasks = tasks;
+    member->emigrate = std::move(emigrate);
+    member->immigrate = std::move(immigrate);
+    member->scheduler = scheduler;
+    member->budget = budget;
+    member->busy_ns = loop->GetStats().busy_ns;
+    member->moving = 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    members_.push_back(std::move(member));
+}
+
+std::size_t Rebalancer::GetMoves() const
+{
+    return moves_.load(std::memory_order_relaxed);
+}
+
+void Rebalancer::RebalanceFunc()
+{
+    auto last = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!cond_.wait_for(lock, interval_, [this] () { return stop_; }))
+    {
+        auto now = std::chrono::steady_clock::now();
+        Rebalance(now - last);
+        last = now;
+    }
+}
+
+void Rebalancer::Rebalance(std::chrono::steady_clock::duration elapsed)
+{
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        elapsed).count();
+    if (elapsed_ns <= 0)
+        return ;
+
+    Member *busiest = nullptr;
+    Member *idlest = nullptr;
+    double max_busy = 0.0;
+    double min_busy = 0.0;
+
+    for (auto &member : members_)
+    {
+        auto busy_ns = member->loop->GetStats().busy_ns;
+        auto busy = static_cast<double>(busy_ns - member->busy_ns) /
+            elapsed_ns;
+        member->busy_ns = busy_ns;
+
+        // Loops with moves in flight are measured again next interval.
+        if (member->moving > 0)
+            continue;
+
+        if (!busiest || busy > max_busy)
+        {
+            busiest = member.get();
+            max_busy = busy;
+        }
+
+        if (!idlest || busy < min_busy)
+        {
+            idlest = member.get();
+            min_busy = busy;
+        }
+    }
+
+    if (!busiest || busiest == idlest || max_busy - min_busy <= threshold_)
+        return ;
+
+    ++busiest->moving;
+    ++idlest->moving;
+    busiest->tasks->Post(Departure(this, busiest, idlest));
+}
+
+} // namespace snet
@@ -0,0 +1,89 @@
+#ifndef REBALANCER_H
+#define REBALANCER_H
+
+#include "Connection.h"
+#include "Delegate.h"
+#include "EventLoop.h"
+#include "LoopTasks.h"
+#include "ReadScheduler.h"
+#include "SendQueueBudget.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace snet
+{
+
+// Thread moving connections from the busiest event loop to the idlest
+// one, when the fractions of time they were busy in the last interval
+// differ by more than threshold. Connections are moved in the threads
+// of loops through their LoopTasks: Emigrate of the busy loop gives up
+// a connection, which is detached, then attached to the idle loop and
+// given to Immigrate of it. Moved connections join the read scheduler
+// and send queue budget of the idle loop, when the loop has them.
+// Destroy the rebalancer after loops stop.
+class Rebalancer final
+{
+public:
+    // Called in the thread of the loop, Emigrate returns nullptr when
+    // there is no connection to move.
+    using Emigrate = Delegate<std::unique_ptr<Connection> ()>;
+    using Immigrate = Delegate<void (std::unique_ptr<Connection>)>;
+
+    // Move at most moves connections in an interval.
+    Rebalancer(std::chrono::milliseconds interval, double threshold,
+               std::size_t moves = 1);
+    ~Rebalancer();
+
+    Rebalancer(const Rebalancer &) = delete;
+    void operator = (const Rebalancer &) = delete;
+
+    // Tasks must be added to loop, and both must outlive the rebalancer,
+    // so must scheduler and budget of the loop if given.
+    void AddLoop(EventLoop *loop, LoopTasks *tasks,
+                 Emigrate emigrate, Immigrate immigrate,
+                 ReadScheduler *scheduler = nullptr,
+                 SendQueueBudget *budget = nullptr);
+
+    std::size_t GetMoves() const;
+
+private:
+    struct Member
+    {
+        EventLoop *loop;
+        LoopTasks *tasks;
+        Emigrate emigrate;
+        Immigrate immigrate;
+        ReadScheduler *scheduler;
+        SendQueueBudget *budget;
+        uint64_t busy_ns;
+        // Tasks in flight moving connections out of or into the loop.
+        std::atomic<int> moving;
+    };
+
+    class Departure;
+    class Arrival;
+
+    void RebalanceFunc();
+    void Rebalance(std::chrono::steady_clock::duration elapsed);
+
+    std::chrono::milliseconds interval_;
+    double threshold_;
+    std::size_t moves_per_interval_;
+    std::atomic<std::size_t> moves_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stop_;
+    std::vector<std::unique_ptr<Member>> members_;
+    std::thread thread_;
+};
+
+} // namespace snet
+
+#endif // REBALANCER_H
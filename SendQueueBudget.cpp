@@ -0,0 +1,138 @@
+#include "SendQueueBudget.h"
+#include "Connection.h"
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+std::atomic<std::size_t> total_evictions(0);
+
+} // namespace
+
+namespace snet
+{
+
+SendQueueBudget::SendQueueBudget(std::size_t budget,
+                                 std::chrono::milliseconds min_stall_time)
+    : budget_(budget),
+      evictions_(0),
+      min_stall_time_(min_stall_time)
+{
+}
+
+void SendQueueBudget::SetOnEvict(OnEvict on_evict)
+{
+    on_evict_ = std::move(on_evict);
+}
+
+std::size_t SendQueueBudget::GetBudget() const
+{
+    return budget_;
+}
+
+std::size_t SendQueueBudget::GetEvictions() const
+{
+    return evictions_;
+}
+
+std::size_t SendQueueBudget::GetConnections() const
+{
+    return connections_.size();
+}
+
+std::size_t SendQueueBudget::GetTotalEvictions()
+{
+    return total_evictions.load(std::memory_order_relaxed);
+}
+
+constexpr std::chrono::milliseconds SendQueueBudget::kCheckInterval;
+
+void SendQueueBudget::HandleLoop()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now < next_check_)
+        return ;
+    next_check_ = now + kCheckInterval;
+
+    auto total = GetTotalQueuedSendBytes();
+    if (total > budget_)
+        Evict(total);
+}
+
+void SendQueueBudget::AddConnection(Connection *connection)
+{
+    connections_.insert(connection);
+}
+
+void SendQueueBudget::DelConnection(Connection *connection)
+{
+    connections_.erase(connection);
+}
+
+void SendQueueBudget::Evict(std::size_t total)
+{
+    using Candidate = std::pair<double, Connection *>;
+
+    auto now = std::chrono::steady_clock::now();
+    std::size_t local = 0;
+    std::vector<Candidate> candidates;
+
+    for (auto connection : connections_)
+    {
+        auto bytes = connection->GetQueuedSendBytes();
+        if (bytes == 0)
+            continue;
+
+        local += bytes;
+
+        // Stall is the age of the oldest unsent data, a consumer which
+        // keeps reading is not stalled even if its queue never empties.
+        auto stall = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - connection->GetOldestUnsentTime());
+        if (stall < min_stall_time_)
+            continue;
+
+        // Larger queue and older unsent data make a slower consumer.
+        auto score = static_cast<double>(bytes) * (stall.count() + 1);
+        candidates.push_back(std::make_pair(score, connection));
+    }
+
+    if (candidates.empty())
+        return ;
+
+    std::sort(candidates.begin(), candidates.end(),
+              [] (const Candidate &l, const Candidate &r) {
+                  return l.first > r.first;
+              });
+
+    // Every loop evicts its share of the excess bytes, so loops evicting
+    // at the same time do not evict much more than needed.
+    auto excess = total - budget_;
+    auto share = static_cast<std::size_t>(
+        static_cast<double>(excess) * local / total) + 1;
+
+    std::size_t evicted = 0;
+    for (auto &candidate : candidates)
+    {
+        if (evicted >= share)
+            break;
+
+        // Connection may be destroyed by the eviction of a previous one.
+        auto connection = candidate.second;
+        if (connections_.find(connection) == connections_.end())
+            continue;
+
+        evicted += connection->GetQueuedSendBytes();
+        ++evictions_;
+        ++total_evictions;
+
+        if (on_evict_)
+            on_evict_(connection);
+        connection->HandleEvict();
+    }
+}
+
+} // namespace snet
@@ -0,0 +1,69 @@
+#ifndef SEND_QUEUE_BUDGET_H
+#define SEND_QUEUE_BUDGET_H
+
+#include "Delegate.h"
+#include "EventLoop.h"
+#include <chrono>
+#include <cstddef>
+#include <set>
+
+namespace snet
+{
+
+class Connection;
+
+// Evict the slowest consumers of an event loop when the bytes queued in
+// send queues of all connections in the process exceed the budget.
+// Create one for each event loop with the same budget, connections join
+// it by Connection::SetSendQueueBudget. Evicted connections drop their
+// send queues and close, then they are reported through OnError. The
+// total is checked, and the connections are scanned when it is over the
+// budget, at most once every kCheckInterval.
+class SendQueueBudget final : public LoopHandler
+{
+public:
+    using OnEvict = Delegate<void (Connection *)>;
+
+    static constexpr std::chrono::milliseconds kCheckInterval =
+        std::chrono::milliseconds(10);
+
+    explicit SendQueueBudget(std::size_t budget,
+                             std::chrono::milliseconds min_stall_time =
+                             std::chrono::milliseconds(1000));
+
+    SendQueueBudget(const SendQueueBudget &) = delete;
+    void operator = (const SendQueueBudget &) = delete;
+
+    // Observer called before a connection is evicted.
+    void SetOnEvict(OnEvict on_evict);
+
+    std::size_t GetBudget() const;
+    std::size_t GetEvictions() const;
+
+    // Connections watched by the budget.
+    std::size_t GetConnections() const;
+
+    // Evictions of all SendQueueBudgets in the process.
+    static std::size_t GetTotalEvictions();
+
+    virtual void HandleLoop() override;
+    virtual void HandleStop() override { }
+
+private:
+    friend class Connection;
+
+    void AddConnection(Connection *connection);
+    void DelConnection(Connection *connection);
+    void Evict(std::size_t total);
+
+    std::size_t budget_;
+    std::size_t evictions_;
+    std::chrono::milliseconds min_stall_time_;
+    std::chrono::steady_clock::time_point next_check_;
+    OnEvict on_evict_;
+    std::set<Connection *> connections_;
+};
+
+} // namespace snet
+
+#endif // SEND_QUEUE_BUDGET_H
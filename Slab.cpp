@@ -0,0 +1,17 @@
+#include "Slab.h"
+
+namespace snet
+{
+
+std::atomic<std::size_t> SlabCounter::reserved_bytes_(0);
+std::atomic<std::size_t> SlabCounter::used_bytes_(0);
+
+SlabStats SlabCounter::GetStats()
+{
+    SlabStats stats;
+    stats.reserved_bytes = reserved_bytes_.load(std::memory_order_relaxed);
+    stats.used_bytes = used_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace snet
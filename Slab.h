@@ -0,0 +1,208 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace snet
+{
+
+struct SlabStats
+{
+    std::size_t reserved_bytes;
+    std::size_t used_bytes;
+};
+
+class SlabCounter
+{
+public:
+    // Bytes of chunks and objects of all slabs in the process.
+    static SlabStats GetStats();
+
+protected:
+    static std::atomic<std::size_t> reserved_bytes_;
+    static std::atomic<std::size_t> used_bytes_;
+};
+
+// Fixed size object allocator. Each thread allocates objects from chunks
+// of its own slab, the slab of an event loop thread works as the slab of
+// the event loop. Objects freed by other threads are returned to the owner
+// slab and reused by the owner thread. Slab is destroyed after its thread
+// exits and all its objects are freed.
+template<std::size_t Size, std::size_t Align = alignof(std::max_align_t)>
+class Slab final : public SlabCounter
+{
+public:
+    Slab(const Slab &) = delete;
+    void operator = (const Slab &) = delete;
+
+    static void * Allocate()
+    {
+        return Local()->AllocateBlock();
+    }
+
+    static void Free(void *ptr)
+    {
+        auto chunk = reinterpret_cast<Chunk *>(
+            reinterpret_cast<uintptr_t>(ptr) & ~(kChunkSize - 1));
+        auto owner = chunk->owner;
+        auto block = static_cast<Block *>(ptr);
+
+        if (owner == local_.slab)
+        {
+            block->next = owner->free_;
+            owner->free_ = block;
+        }
+        else
+        {
+            auto head = owner->remote_free_.load(std::memory_order_relaxed);
+            do
+            {
+                block->next = head;
+            } while (!owner->remote_free_.compare_exchange_weak(
+                    head, block, std::memory_order_release,
+                    std::memory_order_relaxed));
+        }
+
+        used_bytes_.fetch_sub(kBlockSize, std::memory_order_relaxed);
+        owner->Release();
+    }
+
+private:
+    struct Block
+    {
+        Block *next;
+    };
+
+    // Chunk is aligned by its size, so the owner of a block could be
+    // found from its address.
+    struct Chunk
+    {
+        Slab *owner;
+        Chunk *next;
+    };
+
+    struct Holder
+    {
+        Slab *slab;
+
+        ~Holder()
+        {
+            if (slab)
+                slab->Release();
+            slab = nullptr;
+        }
+    };
+
+    static const std::size_t kChunkSize = 64 * 1024;
+    static const std::size_t kAlign = Align > alignof(Block) ?
+        Align : alignof(Block);
+    static const std::size_t kBlockSize =
+        ((Size > sizeof(Block) ? Size : sizeof(Block)) + kAlign - 1)
+        & ~(kAlign - 1);
+    static const std::size_t kChunkHead =
+        (sizeof(Chunk) + kAlign - 1) & ~(kAlign - 1);
+
+    static_assert(kChunkHead + kBlockSize <= kChunkSize,
+                  "Object is too large for slab");
+
+    Slab()
+        : free_(nullptr),
+          chunks_(nullptr),
+          carve_(nullptr),
+          carve_end_(nullptr),
+          remote_free_(nullptr),
+          refs_(1)
+    {
+    }
+
+    ~Slab()
+    {
+        while (chunks_)
+        {
+            auto chunk = chunks_;
+            chunks_ = chunk->next;
+            free(chunk);
+            reserved_bytes_.fetch_sub(kChunkSize, std::memory_order_relaxed);
+        }
+    }
+
+    static Slab * Local()
+    {
+        if (!local_.slab)
+            local_.slab = new Slab;
+        return local_.slab;
+    }
+
+    void * AllocateBlock()
+    {
+        if (!free_)
+            free_ = remote_free_.exchange(nullptr, std::memory_order_acquire);
+
+        void *ptr = nullptr;
+
+        if (free_)
+        {
+            ptr = free_;
+            free_ = free_->next;
+        }
+        else
+        {
+            // Blocks are carved on demand, so the memory of a chunk is
+            // first touched by the owner thread.
+            if (carve_ == carve_end_ && !NewChunk())
+                return nullptr;
+
+            ptr = carve_;
+            carve_ += kBlockSize;
+        }
+
+        refs_.fetch_add(1, std::memory_order_relaxed);
+        used_bytes_.fetch_add(kBlockSize, std::memory_order_relaxed);
+        return ptr;
+    }
+
+    bool NewChunk()
+    {
+        void *mem = nullptr;
+        if (posix_memalign(&mem, kChunkSize, kChunkSize) != 0)
+            return false;
+
+        auto chunk = static_cast<Chunk *>(mem);
+        chunk->owner = this;
+        chunk->next = chunks_;
+        chunks_ = chunk;
+
+        auto begin = static_cast<char *>(mem);
+        carve_ = begin + kChunkHead;
+        carve_end_ = carve_ +
+            (kChunkSize - kChunkHead) / kBlockSize * kBlockSize;
+
+        reserved_bytes_.fetch_add(kChunkSize, std::memory_order_relaxed);
+        return true;
+    }
+
+    void Release()
+    {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    static thread_local Holder local_;
+
+    Block *free_;
+    Chunk *chunks_;
+    char *carve_;
+    char *carve_end_;
+    std::atomic<Block *> remote_free_;
+    std::atomic<std::size_t> refs_;
+};
+
+template<std::size_t Size, std::size_t Align>
+thread_local typename Slab<Size, Align>::Holder Slab<Size, Align>::local_;
+
+} // namespace snet
+
+#endif // SLAB_H
@@ -34,6 +34,39 @@ void SetSocketTcpNoDelay(int fd)
     setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
 }
 
+bool GetSocketTcpInfo(int fd, TcpInfo *info)
+{
+#if defined(__linux__)
+    struct tcp_info tcpi;
+    socklen_t len = sizeof(tcpi);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &tcpi, &len) < 0)
+        return false;
+
+    info->rtt_us = tcpi.tcpi_rtt;
+    info->rtt_var_us = tcpi.tcpi_rttvar;
+    info->cwnd = tcpi.tcpi_snd_cwnd;
+    info->ssthresh = tcpi.tcpi_snd_ssthresh;
+    info->total_retransmits = tcpi.tcpi_total_retrans;
+    info->unacked = tcpi.tcpi_unacked;
+    return true;
+#else
+    return false;
+#endif
+}
+
+int GetSocketIncomingCpu(int fd)
+{
+#if defined(__linux__) && defined(SO_INCOMING_CPU)
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0)
+        return -1;
+    return cpu;
+#else
+    return -1;
+#endif
+}
+
 void SetSockAddrIn(struct sockaddr_in *sin,
                    const char *ip, unsigned short port)
 {
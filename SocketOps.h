@@ -11,16 +11,39 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <stdint.h>
 #include <string>
 
 namespace snet
 {
 
+// Kernel view of a TCP connection.
+struct TcpInfo
+{
+    // Smoothed round trip time and its mean deviation in microseconds.
+    uint32_t rtt_us;
+    uint32_t rtt_var_us;
+    // Congestion window and slow start threshold in segments.
+    uint32_t cwnd;
+    uint32_t ssthresh;
+    // Segments retransmitted over the lifetime of the connection.
+    uint32_t total_retransmits;
+    // Segments sent and not acknowledged yet.
+    uint32_t unacked;
+};
+
 bool SetSocketNonBlock(int fd);
 void SetSocketReuseAddr(int fd);
 void SetSocketKeepAlive(int fd);
 void SetSocketTcpNoDelay(int fd);
 
+// Read TCP_INFO of fd, return false when it is not supported.
+bool GetSocketTcpInfo(int fd, TcpInfo *info);
+
+// CPU which processed the latest received packets of fd, -1 when it is
+// unknown or not supported.
+int GetSocketIncomingCpu(int fd);
+
 void SetSockAddrIn(struct sockaddr_in *sin,
                    const char *ip, unsigned short port);
 
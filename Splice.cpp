@@ -0,0 +1,149 @@
+#include "Splice.h"
+#include "FlightRecorder.h"
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+namespace snet
+{
+
+Splice::Splice(Connection *from, Connection *to)
+    : pipe_bytes_(0),
+      eof_(false),
+      shutdown_done_(false),
+      read_paused_(false),
+      from_(from),
+      to_(to)
+{
+    if (pipe2(pipe_, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        pipe_[0] = -1;
+        pipe_[1] = -1;
+        return ;
+    }
+
+    from_->SetOnReceivable([this] () { HandleReceivable(); });
+    to_->SetOnSendComplete([this] () { HandleWritable(); });
+}
+
+Splice::~Splice()
+{
+    if (pipe_[0] >= 0)
+        close(pipe_[0]);
+    if (pipe_[1] >= 0)
+        close(pipe_[1]);
+}
+
+bool Splice::IsOk() const
+{
+    return pipe_[0] >= 0;
+}
+
+void Splice::SetOnEof(OnEof on_eof)
+{
+    on_eof_ = std::move(on_eof);
+}
+
+void Splice::SetOnError(OnError on_error)
+{
+    on_error_ = std::move(on_error);
+}
+
+void Splice::HandleReceivable()
+{
+    if (eof_ || pipe_bytes_ > 0)
+        return ;
+
+    auto bytes = splice(from_->Fd(), nullptr, pipe_[1], nullptr, kSpliceSize,
+                        SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+    if (bytes == 0)
+    {
+        eof_ = true;
+        from_->PauseRead();
+    }
+    else if (bytes < 0)
+    {
+        if (errno != EAGAIN && errno != EINTR)
+            return HandleError();
+        return ;
+    }
+    else
+    {
+        SNET_TRACE(BytesReceived, from_->Fd(), bytes);
+        pipe_bytes_ += bytes;
+    }
+
+    Flush();
+}
+
+void Splice::HandleWritable()
+{
+    if (shutdown_done_)
+        return ;
+
+    if (pipe_bytes_ > 0 || eof_)
+        Flush();
+}
+
+void Splice::Flush()
+{
+    // Buffers queued in to connection must be sent before the pipe data.
+    while (pipe_bytes_ > 0 && to_->GetQueuedSendBytes() == 0)
+    {
+        auto bytes = splice(pipe_[0], nullptr, to_->Fd(), nullptr,
+                            pipe_bytes_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+        if (bytes < 0)
+        {
+            if (errno != EAGAIN && errno != EINTR)
+                return HandleError();
+            break;
+        }
+
+        SNET_TRACE(BytesSent, to_->Fd(), bytes);
+        pipe_bytes_ -= bytes;
+    }
+
+    if (pipe_bytes_ > 0)
+    {
+        // Stop reading until to connection drains the pipe.
+        if (!read_paused_ && !eof_)
+        {
+            read_paused_ = true;
+            from_->PauseRead();
+        }
+
+        if (to_->GetQueuedSendBytes() == 0)
+            to_->WaitWritable();
+        return ;
+    }
+
+    if (eof_)
+    {
+        // Shutdown cuts the send queue of to connection, so wait for it
+        // to drain, HandleWritable is called then.
+        if (shutdown_done_ || to_->GetQueuedSendBytes() > 0)
+            return ;
+
+        shutdown_done_ = true;
+        to_->Shutdown(ShutdownT::Write);
+        if (on_eof_)
+            on_eof_();
+        return ;
+    }
+
+    if (read_paused_)
+    {
+        read_paused_ = false;
+        from_->ResumeRead();
+    }
+}
+
+void Splice::HandleError()
+{
+    if (on_error_)
+        on_error_();
+}
+
+} // namespace snet
@@ -0,0 +1,57 @@
+#ifndef SPLICE_H
+#define SPLICE_H
+
+#include "Connection.h"
+#include "Delegate.h"
+
+namespace snet
+{
+
+// Move data from one connection to another through a kernel pipe by
+// splice(), so the data never gets into user space. It takes over the
+// OnReceivable of the from connection and the OnSendComplete of the to
+// connection. Use two Splices to relay both directions. Linux only.
+class Splice final
+{
+public:
+    using OnEof = Delegate<void ()>;
+    using OnError = Delegate<void ()>;
+
+    Splice(Connection *from, Connection *to);
+    ~Splice();
+
+    Splice(const Splice &) = delete;
+    void operator = (const Splice &) = delete;
+
+    bool IsOk() const;
+
+    // Called once when the from connection is closed by peer and all
+    // data, including the buffers queued in the to connection, is sent,
+    // then write of to is shutdown.
+    void SetOnEof(OnEof on_eof);
+    void SetOnError(OnError on_error);
+
+private:
+    void HandleReceivable();
+    void HandleWritable();
+    void Flush();
+    void HandleError();
+
+    static const std::size_t kSpliceSize = 64 * 1024;
+
+    int pipe_[2];
+    std::size_t pipe_bytes_;
+    bool eof_;
+    bool shutdown_done_;
+    bool read_paused_;
+
+    Connection *from_;
+    Connection *to_;
+
+    OnEof on_eof_;
+    OnError on_error_;
+};
+
+} // namespace snet
+
+#endif // SPLICE_H
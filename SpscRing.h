@@ -0,0 +1,215 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "Parker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace snet
+{
+
+// Bounded ring of one producer thread and one consumer thread. Indexes
+// of each side are on their own cache line, with a cached copy of the
+// index of the other side, so the sides only share cache lines when the
+// ring looks full or empty. A full ring pushes back on the producer.
+// Blocking calls spin, yield, then park, see Parker.
+template<typename T>
+class SpscRing final
+{
+public:
+    using Type = T;
+
+    // Capacity is rounded up to power of 2.
+    explicit SpscRing(std::size_t capacity)
+        : mask_(RoundUp(capacity) - 1),
+          slots_(new T[mask_ + 1]),
+          tail_(0),
+          cached_head_(0),
+          head_(0),
+          cached_tail_(0)
+    {
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    void operator = (const SpscRing &) = delete;
+
+    std::size_t Capacity() const
+    {
+        return mask_ + 1;
+    }
+
+    // Producer thread only. Return false when the ring is full.
+    template<typename U>
+    bool TryPush(U &&u)
+    {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (Free(tail) == 0)
+            return false;
+
+        slots_[tail & mask_] = std::forward<U>(u);
+        Publish(tail + 1);
+        return true;
+    }
+
+    // Producer thread only. Move items until the ring is full, return
+    // the number of items moved.
+    std::size_t TryPushBatch(T *items, std::size_t count)
+    {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        auto n = std::min(count, Free(tail));
+        if (n == 0)
+            return 0;
+
+        for (std::size_t i = 0; i < n; ++i)
+            slots_[(tail + i) & mask_] = std::move(items[i]);
+        Publish(tail + n);
+        return n;
+    }
+
+    // Producer thread only, wait while the ring is full.
+    template<typename U>
+    void Push(U &&u)
+    {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (Free(tail) == 0)
+            not_full_.Wait([this, tail] () { return Free(tail) > 0; });
+
+        slots_[tail & mask_] = std::forward<U>(u);
+        Publish(tail + 1);
+    }
+
+    // Producer thread only, wait until all items are moved.
+    void PushBatch(T *items, std::size_t count)
+    {
+        while (count > 0)
+        {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            if (Free(tail) == 0)
+                not_full_.Wait([this, tail] () { return Free(tail) > 0; });
+
+            auto n = TryPushBatch(items, count);
+            items += n;
+            count -= n;
+        }
+    }
+
+    // Consumer thread only. Return false when the ring is empty.
+    bool TryPop(T *t)
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (Available(head) == 0)
+            return false;
+
+        *t = std::move(slots_[head & mask_]);
+        Release(head + 1);
+        return true;
+    }
+
+    // Consumer thread only. Move at most max items into items, return
+    // the number of items moved.
+    std::size_t TryPopBatch(T *items, std::size_t max)
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        auto n = std::min(max, Available(head));
+        if (n == 0)
+            return 0;
+
+        for (std::size_t i = 0; i < n; ++i)
+            items[i] = std::move(slots_[(head + i) & mask_]);
+        Release(head + n);
+        return n;
+    }
+
+    // Consumer thread only, wait while the ring is empty.
+    T Pop()
+    {
+        WaitAvailable();
+
+        auto head = head_.load(std::memory_order_relaxed);
+        T t(std::move(slots_[head & mask_]));
+        Release(head + 1);
+        return t;
+    }
+
+    // Consumer thread only, wait while the ring is empty, then move at
+    // most max items into items. Max must not be 0.
+    std::size_t PopBatch(T *items, std::size_t max)
+    {
+        WaitAvailable();
+        return TryPopBatch(items, max);
+    }
+
+private:
+    static std::size_t RoundUp(std::size_t capacity)
+    {
+        std::size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    // Free slots seen by the producer, head is reloaded only when the
+    // cached head shows the ring full.
+    std::size_t Free(std::size_t tail)
+    {
+        auto size = mask_ + 1;
+        if (tail - cached_head_ == size)
+            cached_head_ = head_.load(std::memory_order_acquire);
+        return size - (tail - cached_head_);
+    }
+
+    // Items seen by the consumer, tail is reloaded only when the cached
+    // tail shows the ring empty.
+    std::size_t Available(std::size_t head)
+    {
+        if (cached_tail_ == head)
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+        return cached_tail_ - head;
+    }
+
+    void WaitAvailable()
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (Available(head) == 0)
+            not_empty_.Wait([this, head] () { return Available(head) > 0; });
+    }
+
+    void Publish(std::size_t tail)
+    {
+        tail_.store(tail, std::memory_order_release);
+        not_empty_.Notify();
+    }
+
+    void Release(std::size_t head)
+    {
+        head_.store(head, std::memory_order_release);
+        not_full_.Notify();
+    }
+
+    // Read-only after construction.
+    const std::size_t mask_;
+    std::unique_ptr<T []> slots_;
+    char padding0_[64];
+
+    // Written by the producer.
+    std::atomic<std::size_t> tail_;
+    std::size_t cached_head_;
+    char padding1_[64];
+
+    // Written by the consumer.
+    std::atomic<std::size_t> head_;
+    std::size_t cached_tail_;
+    char padding2_[64];
+
+    // Consumer waits for not empty, producer waits for not full.
+    Parker not_empty_;
+    char padding3_[64];
+    Parker not_full_;
+};
+
+} // namespace snet
+
+#endif // SPSC_RING_H
@@ -1,6 +1,15 @@
 #include "Timer.h"
+#include "LoopMonitor.h"
 #include <vector>
 
+namespace
+{
+
+// Timers are fired after waits of the loop, which wait 20ms at most.
+const snet::Milliseconds kLateTimeout(25);
+
+} // namespace
+
 namespace snet
 {
 
@@ -22,9 +31,9 @@ void Timer::ExpireAt(const TimePoint &time_point)
     timer_list_->AddTimer(&handle_);
 }
 
-void Timer::SetOnTimeout(const OnTimeout &on_timeout)
+void Timer::SetOnTimeout(OnTimeout on_timeout)
 {
-    on_timeout_ = on_timeout;
+    on_timeout_ = std::move(on_timeout);
 }
 
 void Timer::Cancel()
@@ -48,7 +57,12 @@ void TimerList::DelTimer(Timer::Handle *timer)
         std::make_pair(timer->GetTimePoint(), timer));
 }
 
-void TimerList::TickTock()
+std::size_t TimerList::Size() const
+{
+    return timer_set_.size();
+}
+
+std::size_t TimerList::TickTock(Milliseconds late, LoopMonitor *monitor)
 {
     auto now = std::chrono::steady_clock::now();
     auto max_ptr = reinterpret_cast<Timer::Handle *>(~uintptr_t(0));
@@ -56,24 +70,52 @@ void TimerList::TickTock()
     auto begin = timer_set_.begin();
     auto end = timer_set_.lower_bound(std::make_pair(now, max_ptr));
 
+    std::size_t late_timers = 0;
     if (begin != end)
     {
         std::vector<TimerSet::value_type> expired(begin, end);
         timer_set_.erase(begin, end);
 
         for (auto &pair : expired)
+        {
+            auto lateness = std::chrono::duration_cast<Milliseconds>(
+                now - pair.first);
+            if (lateness >= late)
+                ++late_timers;
+        }
+
+        for (auto &pair : expired)
+        {
+            SNET_TRACE(TimerFired, -1,
+                       std::chrono::duration_cast<std::chrono::microseconds>(
+                           now - pair.first).count());
+            CallbackScope scope(monitor, CallbackSite::Timer,
+                                pair.second, -1);
             pair.second->Timeout();
+        }
     }
+
+    return late_timers;
 }
 
-TimerDriver::TimerDriver(TimerList &timer_list)
-    : timer_list_(timer_list)
+TimerDriver::TimerDriver(TimerList &timer_list, EventLoop *loop)
+    : timer_list_(timer_list),
+      loop_(loop)
 {
 }
 
 void TimerDriver::HandleLoop()
 {
-    timer_list_.TickTock();
+    if (!loop_)
+    {
+        timer_list_.TickTock();
+        return ;
+    }
+
+    auto &counters = loop_->Counters();
+    counters.late_timers.Add(
+        timer_list_.TickTock(kLateTimeout, loop_->Monitor()));
+    counters.timers_pending.Set(timer_list_.Size());
 }
 
 } // namespace snet
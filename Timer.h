@@ -1,9 +1,9 @@
 #ifndef TIMER_H
 #define TIMER_H
 
+#include "Delegate.h"
 #include "EventLoop.h"
 #include <chrono>
-#include <functional>
 #include <set>
 
 namespace snet
@@ -15,6 +15,7 @@ using Seconds = std::chrono::seconds;
 using Minutes = std::chrono::minutes;
 using Hours = std::chrono::hours;
 
+class LoopMonitor;
 class TimerList;
 
 class Timer final
@@ -46,7 +47,7 @@ public:
         Timer *timer_;
     };
 
-    using OnTimeout = std::function<void ()>;
+    using OnTimeout = Delegate<void ()>;
 
     explicit Timer(TimerList *timer_list);
     ~Timer();
@@ -61,7 +62,7 @@ public:
     }
 
     void ExpireAt(const TimePoint &time_point);
-    void SetOnTimeout(const OnTimeout &on_timeout);
+    void SetOnTimeout(OnTimeout on_timeout);
     void Cancel();
 
 private:
@@ -81,7 +82,13 @@ public:
 
     void AddTimer(Timer::Handle *timer);
     void DelTimer(Timer::Handle *timer);
-    void TickTock();
+    std::size_t Size() const;
+
+    // Fire expired timers, return the number of timers fired late by
+    // late or more after their time points. Timer callbacks are timed
+    // by monitor when it is not nullptr.
+    std::size_t TickTock(Milliseconds late = Milliseconds::max(),
+                         LoopMonitor *monitor = nullptr);
 
 private:
     using TimerSet = std::set<std::pair<TimePoint, Timer::Handle *>>;
@@ -89,10 +96,12 @@ private:
     TimerSet timer_set_;
 };
 
+// Drive timers of timer_list in an event loop. When loop is given, the
+// pending and late timers are counted in the stats of the loop.
 class TimerDriver final : public LoopHandler
 {
 public:
-    explicit TimerDriver(TimerList &timer_list);
+    explicit TimerDriver(TimerList &timer_list, EventLoop *loop = nullptr);
 
     TimerDriver(const TimerDriver &) = delete;
     void operator = (const TimerDriver &) = delete;
@@ -102,6 +111,7 @@ public:
 
 private:
     TimerList &timer_list_;
+    EventLoop *loop_;
 };
 
 } // namespace snet
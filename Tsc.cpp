@@ -0,0 +1,39 @@
+#include "Tsc.h"
+
+namespace
+{
+
+double MeasureNanosecondsPerTick()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    using Clock = std::chrono::steady_clock;
+
+    auto begin = Clock::now();
+    auto tsc_begin = snet::ReadTsc();
+
+    auto end = begin;
+    while (end - begin < std::chrono::milliseconds(10))
+        end = Clock::now();
+
+    auto tsc_end = snet::ReadTsc();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        end - begin).count();
+
+    if (tsc_end > tsc_begin)
+        return static_cast<double>(ns) / (tsc_end - tsc_begin);
+#endif
+    return 1.0;
+}
+
+} // namespace
+
+namespace snet
+{
+
+double TscNanosecondsPerTick()
+{
+    static const double ns_per_tick = MeasureNanosecondsPerTick();
+    return ns_per_tick;
+}
+
+} // namespace snet
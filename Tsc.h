@@ -0,0 +1,41 @@
+#ifndef TSC_H
+#define TSC_H
+
+#include <chrono>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace snet
+{
+
+// Cheap monotonic tick counter. It is the time stamp counter on x86 and
+// the virtual counter on arm64, which are synchronized between cores on
+// the supported platforms, other platforms fall back to steady_clock.
+inline uint64_t ReadTsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Nanoseconds of one tick, measured against steady_clock at first call.
+double TscNanosecondsPerTick();
+
+inline uint64_t TscToNanoseconds(uint64_t ticks)
+{
+    return static_cast<uint64_t>(ticks * TscNanosecondsPerTick());
+}
+
+} // namespace snet
+
+#endif // TSC_H
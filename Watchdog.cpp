@@ -0,0 +1,112 @@
+#include "Watchdog.h"
+#include <algorithm>
+
+namespace snet
+{
+
+Watchdog::Watchdog(std::chrono::milliseconds budget, OnStall on_stall)
+    : budget_ticks_(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                budget).count() / TscNanosecondsPerTick())),
+      interval_(std::max(budget / 2, std::chrono::milliseconds(1))),
+      on_stall_(std::move(on_stall)),
+      stalls_(0),
+      stop_(false),
+      thread_(&Watchdog::WatchFunc, this)
+{
+}
+
+Watchdog::~Watchdog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+
+    cond_.notify_one();
+    thread_.join();
+}
+
+void Watchdog::Watch(LoopMonitor *monitor)
+{
+    Watched watched;
+    watched.monitor = monitor;
+    watched.reported_iteration = 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    watched_.push_back(watched);
+}
+
+void Watchdog::Unwatch(LoopMonitor *monitor)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    watched_.erase(
+        std::remove_if(watched_.begin(), watched_.end(),
+                       [monitor] (const Watched &watched) {
+                           return watched.monitor == monitor;
+                       }),
+        watched_.end());
+}
+
+std::size_t Watchdog::GetStalls() const
+{
+    return stalls_.load(std::memory_order_relaxed);
+}
+
+void Watchdog::WatchFunc()
+{
+    std::vector<Stall> stalls;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait_for(lock, interval_, [this] () { return stop_; });
+            if (stop_)
+                break;
+
+            Check(&stalls);
+        }
+
+        // Callbacks are called without the lock, so they could watch or
+        // unwatch loops.
+        for (auto &stall : stalls)
+        {
+            if (on_stall_)
+                on_stall_(stall);
+        }
+
+        stalls.clear();
+    }
+}
+
+void Watchdog::Check(std::vector<Stall> *stalls)
+{
+    auto now = ReadTsc();
+
+    for (auto &watched : watched_)
+    {
+        auto monitor = watched.monitor;
+        auto busy_since = monitor->busy_since_.load(std::memory_order_relaxed);
+        auto iteration = monitor->iteration_.load(std::memory_order_relaxed);
+
+        if (busy_since == 0 || now < busy_since ||
+            now - busy_since < budget_ticks_ ||
+            iteration == watched.reported_iteration)
+            continue;
+
+        watched.reported_iteration = iteration;
+        ++stalls_;
+
+        Stall stall;
+        stall.monitor = monitor;
+        stall.busy_ns = TscToNanoseconds(now - busy_since);
+        stall.site = static_cast<CallbackSite>(
+            monitor->site_.load(std::memory_order_relaxed));
+        stall.handler = monitor->handler_.load(std::memory_order_relaxed);
+        stall.fd = monitor->fd_.load(std::memory_order_relaxed);
+        stalls->push_back(stall);
+    }
+}
+
+} // namespace snet
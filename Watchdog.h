@@ -0,0 +1,72 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include "Delegate.h"
+#include "LoopMonitor.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace snet
+{
+
+// Thread watching event loops through their LoopMonitors, it reports an
+// iteration of a loop running longer than the budget once, with the
+// callback being run when it is found.
+class Watchdog final
+{
+public:
+    struct Stall
+    {
+        LoopMonitor *monitor;
+        // Time of the iteration has run when it is found.
+        uint64_t busy_ns;
+        // Callback being run, site is None between callbacks.
+        CallbackSite site;
+        const void *handler;
+        int fd;
+    };
+
+    // OnStall is called in the thread of watchdog.
+    using OnStall = Delegate<void (const Stall &)>;
+
+    // Loops are checked every half of budget.
+    Watchdog(std::chrono::milliseconds budget, OnStall on_stall);
+    ~Watchdog();
+
+    Watchdog(const Watchdog &) = delete;
+    void operator = (const Watchdog &) = delete;
+
+    void Watch(LoopMonitor *monitor);
+    void Unwatch(LoopMonitor *monitor);
+
+    std::size_t GetStalls() const;
+
+private:
+    struct Watched
+    {
+        LoopMonitor *monitor;
+        uint64_t reported_iteration;
+    };
+
+    void WatchFunc();
+    void Check(std::vector<Stall> *stalls);
+
+    uint64_t budget_ticks_;
+    std::chrono::milliseconds interval_;
+    OnStall on_stall_;
+    std::atomic<std::size_t> stalls_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stop_;
+    std::vector<Watched> watched_;
+    std::thread thread_;
+};
+
+} // namespace snet
+
+#endif // WATCHDOG_H
@@ -0,0 +1,106 @@
+#include "AdminServer.h"
+#include "EventLoop.h"
+#include "Timer.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+const unsigned short kPort = 18765;
+
+// Send request by a blocking socket and read the response until the
+// server shuts down the connection.
+std::string Request(const std::string &request)
+{
+    auto fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return std::string();
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    std::string response;
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) == 0 &&
+        write(fd, request.data(), request.size()) ==
+        static_cast<ssize_t>(request.size()))
+    {
+        char buf[1024];
+        ssize_t bytes;
+        while ((bytes = read(fd, buf, sizeof(buf))) > 0)
+            response.append(buf, bytes);
+    }
+
+    close(fd);
+    return response;
+}
+
+bool Contains(const std::string &str, const char *sub)
+{
+    return str.find(sub) != std::string::npos;
+}
+
+} // namespace
+
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    snet::AdminServer admin("127.0.0.1", kPort, loop);
+    if (!admin.IsListenOk())
+        return 1;
+
+    admin.AddLoop("main", loop);
+
+    // Stop the loop when the client is done.
+    std::atomic<bool> done(false);
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    snet::Timer stopper(&timer_list);
+    stopper.SetOnTimeout([&] () {
+        if (done)
+            loop->Stop();
+        else
+            stopper.ExpireFromNow(snet::Milliseconds(5));
+    });
+    stopper.ExpireFromNow(snet::Milliseconds(5));
+
+    std::string json, text, http, unknown;
+    std::thread client([&] () {
+        json = Request("json\n");
+        text = Request("stats\r\n");
+        http = Request("GET /json HTTP/1.0\r\nHost: localhost\r\n\r\n");
+        unknown = Request("GET /none HTTP/1.0\r\n\r\n");
+        done = true;
+    });
+
+    event_loop->Loop();
+    client.join();
+
+    printf("%s%s%s", json.c_str(), text.c_str(), http.c_str());
+
+    return Contains(json, "{\"loops\":{\"main\":{\"iterations\":") &&
+        Contains(json, "\"process\":{\"queued_send_bytes\":") &&
+        Contains(json,
+                 ",\"send_queue_evictions\":0,\"slab_reserved_bytes\":") &&
+        Contains(text, "loop.main.handlers ") &&
+        Contains(text, "process.send_queue_evictions 0\n") &&
+        Contains(text, "process.slab_used_bytes ") &&
+        Contains(http, "HTTP/1.0 200 OK\r\n") &&
+        Contains(http, "Content-Type: application/json") &&
+        Contains(unknown, "HTTP/1.0 404 Not Found\r\n") ? 0 : 1;
+}
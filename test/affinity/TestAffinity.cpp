@@ -0,0 +1,79 @@
+#include "Affinity.h"
+#include <stdio.h>
+#include <thread>
+
+int main()
+{
+    auto cpus = snet::GetCpuCount();
+    auto nodes = snet::GetNumaNodeCount();
+    printf("cpus %d, numa nodes %d\n", cpus, nodes);
+
+    int node_cpus = 0;
+    for (int node = 0; node < nodes; ++node)
+    {
+        auto list = snet::GetNumaNodeCpus(node);
+        printf("node %d:", node);
+        for (auto cpu : list)
+        {
+            printf(" %d", cpu);
+            if (snet::GetCpuNumaNode(cpu) != node)
+                return 1;
+        }
+        printf("\n");
+        node_cpus += static_cast<int>(list.size());
+    }
+
+    if (node_cpus == 0 || node_cpus > cpus)
+        return 1;
+
+    auto allowed = snet::GetAllowedCpus();
+    printf("allowed:");
+    for (auto cpu : allowed)
+    {
+        printf(" %d", cpu);
+        if (cpu < 0 || cpu >= cpus)
+            return 1;
+    }
+    printf("\n");
+
+    if (allowed.empty())
+        return 1;
+
+    // Pin a thread to the node of the last allowed CPU, then to the CPU.
+    bool ok = true;
+    std::thread thread([&ok, &allowed] () {
+        auto last = allowed.back();
+        auto node = snet::GetCpuNumaNode(last);
+        if (!snet::PinCurrentThreadToNode(node))
+        {
+            printf("pinning is not supported\n");
+            return ;
+        }
+
+        ok = snet::PinCurrentThreadToCpu(last) &&
+            snet::GetCurrentCpu() == last;
+        printf("pinned to cpu %d, running on cpu %d\n",
+               last, snet::GetCurrentCpu());
+    });
+    thread.join();
+
+    // Loops 0 and 1 are pinned to CPU 0, loop 2 is not pinned.
+    snet::CpuLoopMap map;
+    map.AddLoop(0, 0);
+    map.AddLoop(1, 0);
+    map.AddLoop(2, -1);
+
+    ok = ok && map.FindLoop(0) == 0 && map.FindLoop(0) == 1 &&
+        map.FindLoop(0) == 0;
+    ok = ok && map.FindLoop(-1) == 0 && map.FindLoop(-1) == 1 &&
+        map.FindLoop(-1) == 2;
+
+    // CPUs of node of CPU 0 without loops use the loops on the node.
+    for (auto cpu : snet::GetNumaNodeCpus(snet::GetCpuNumaNode(0)))
+    {
+        auto loop = map.FindLoop(cpu);
+        ok = ok && (loop == 0 || loop == 1);
+    }
+
+    return ok ? 0 : 1;
+}
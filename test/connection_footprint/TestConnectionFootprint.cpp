@@ -0,0 +1,135 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "Slab.h"
+#include "SocketOps.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace
+{
+
+std::atomic<long long> heap_bytes(0);
+
+// Record the size in front of the memory to count the freed bytes.
+const std::size_t kHeader = 16;
+
+__attribute__((noinline)) void * CountedAlloc(std::size_t size)
+{
+    auto p = static_cast<char *>(malloc(size + kHeader));
+    if (!p)
+        return nullptr;
+
+    *reinterpret_cast<std::size_t *>(p) = size;
+    heap_bytes += size;
+    return p + kHeader;
+}
+
+__attribute__((noinline)) void CountedFree(void *ptr)
+{
+    auto p = static_cast<char *>(ptr) - kHeader;
+    heap_bytes -= *reinterpret_cast<std::size_t *>(p);
+    free(p);
+}
+
+} // namespace
+
+void * operator new(std::size_t size)
+{
+    auto p = CountedAlloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr)
+        CountedFree(ptr);
+}
+
+namespace
+{
+
+bool CreateConnections(int num, int fd, snet::EventLoop *loop,
+                       std::vector<std::unique_ptr<snet::Connection>> *out)
+{
+    for (int i = 0; i < num; ++i)
+    {
+        auto dup_fd = dup(fd);
+        if (dup_fd < 0 || !snet::SetSocketNonBlock(dup_fd))
+        {
+            fprintf(stderr, "Create connection %d failed\n", i);
+            return false;
+        }
+
+        std::unique_ptr<snet::Connection> connection(
+            new snet::Connection(dup_fd, loop));
+        connection->SetOnReceivable([] () { });
+        connection->SetOnError([] () { });
+        out->push_back(std::move(connection));
+    }
+
+    return true;
+}
+
+} // namespace
+
+// First round grows the fd indexed handler table of the loop, which every
+// registered fd costs whatever its handler is. Second round reuses the
+// table and the slab, so its heap bytes are those of Connection itself.
+int main(int argc, const char **argv)
+{
+    int num = argc > 1 ? atoi(argv[1]) : 10000;
+
+    if (!snet::SetMaxOpenFiles(num + 64))
+    {
+        fprintf(stderr, "Change max open files to %d failed\n", num + 64);
+        return 1;
+    }
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return 1;
+
+    auto event_loop = snet::CreateEventLoop();
+    std::vector<std::unique_ptr<snet::Connection>> connections;
+    connections.reserve(num);
+
+    auto heap_before = heap_bytes.load();
+    auto slab_before = snet::SlabCounter::GetStats();
+
+    if (!CreateConnections(num, fds[0], event_loop.get(), &connections))
+        return 1;
+
+    auto first_heap = heap_bytes.load() - heap_before;
+    auto slab = snet::SlabCounter::GetStats();
+    auto slab_used = slab.used_bytes - slab_before.used_bytes;
+    auto slab_reserved = slab.reserved_bytes - slab_before.reserved_bytes;
+
+    connections.clear();
+
+    heap_before = heap_bytes.load();
+    if (!CreateConnections(num, fds[0], event_loop.get(), &connections))
+        return 1;
+    auto heap = heap_bytes.load() - heap_before;
+
+    printf("connections:               %d\n", num);
+    printf("sizeof(Connection):        %zu\n", sizeof(snet::Connection));
+    printf("heap bytes per connection: %.1f\n",
+           static_cast<double>(heap) / num);
+    printf("loop table bytes per fd:   %.1f\n",
+           static_cast<double>(first_heap - heap) / num);
+    printf("slab bytes per connection: %.1f\n",
+           static_cast<double>(slab_used) / num);
+    printf("slab reserved bytes:       %zu\n", slab_reserved);
+
+    connections.clear();
+    close(fds[0]);
+    close(fds[1]);
+
+    return heap == 0 ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "SocketOps.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <memory>
+
+namespace
+{
+
+const std::size_t kBufferSize = 64 * 1024;
+const int kBuffers = 64;
+
+// Connect a pair of TCP sockets through loopback.
+bool TcpPair(int fds[2])
+{
+    auto listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0)
+        return false;
+
+    struct sockaddr_in addr;
+    snet::SetSockAddrIn(&addr, "127.0.0.1", 0);
+    socklen_t len = sizeof(addr);
+
+    auto sa = reinterpret_cast<struct sockaddr *>(&addr);
+    bool ok = bind(listener, sa, sizeof(addr)) == 0 &&
+        listen(listener, 1) == 0 &&
+        getsockname(listener, sa, &len) == 0;
+
+    fds[0] = fds[1] = -1;
+    if (ok)
+    {
+        fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+        ok = fds[0] >= 0 && connect(fds[0], sa, sizeof(addr)) == 0;
+    }
+    if (ok)
+    {
+        fds[1] = accept(listener, nullptr, nullptr);
+        ok = fds[1] >= 0;
+    }
+
+    close(listener);
+    return ok && snet::SetSocketNonBlock(fds[0]) &&
+        snet::SetSocketNonBlock(fds[1]);
+}
+
+void Print(const char *name, const snet::ConnectionStats &stats)
+{
+    printf("%s: sent %llu/%llu received %llu/%llu peak %zu blocked %lluns\n",
+           name,
+           static_cast<unsigned long long>(stats.bytes_sent),
+           static_cast<unsigned long long>(stats.messages_sent),
+           static_cast<unsigned long long>(stats.bytes_received),
+           static_cast<unsigned long long>(stats.messages_received),
+           stats.send_queue_peak,
+           static_cast<unsigned long long>(stats.send_blocked_ns));
+}
+
+} // namespace
+
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    int fds[2];
+    if (!TcpPair(fds))
+        return 1;
+
+    std::unique_ptr<snet::Connection> sender(
+        new snet::Connection(fds[0], loop));
+    std::unique_ptr<snet::Connection> receiver(
+        new snet::Connection(fds[1], loop));
+    sender->EnableStats();
+    receiver->EnableStats();
+
+    // Receiver starts reading late, so the send queue of sender grows.
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    receiver->PauseRead();
+    snet::Timer resume(&timer_list);
+    resume.SetOnTimeout([&receiver] () { receiver->ResumeRead(); });
+    resume.ExpireFromNow(snet::Milliseconds(20));
+
+    std::size_t received = 0;
+    receiver->SetOnReceivable([&] () {
+        char buf[16 * 1024];
+        while (true)
+        {
+            snet::Buffer buffer(buf, sizeof(buf));
+            auto ret = receiver->Recv(&buffer);
+            if (ret <= 0)
+                break;
+
+            received += ret;
+            if (received == kBufferSize * kBuffers)
+                loop->Stop();
+        }
+    });
+
+    for (int i = 0; i < kBuffers; ++i)
+    {
+        std::unique_ptr<snet::Buffer> buffer(new snet::Buffer(
+                new char[kBufferSize](), kBufferSize, snet::OpDeleter));
+        sender->Send(std::move(buffer));
+    }
+
+    event_loop->Loop();
+
+    snet::TcpInfo info;
+    auto has_info = sender->GetTcpInfo(&info);
+    if (has_info)
+        printf("rtt %uus rttvar %uus cwnd %u retransmits %u unacked %u\n",
+               info.rtt_us, info.rtt_var_us, info.cwnd,
+               info.total_retransmits, info.unacked);
+
+    auto sent = sender->GetStats();
+    auto recv = receiver->GetStats();
+    auto loop_stats = loop->GetStats();
+    Print("sender", sent);
+    Print("receiver", recv);
+
+    const uint64_t total = kBufferSize * kBuffers;
+    return sent.bytes_sent == total && sent.messages_sent == kBuffers &&
+        sent.send_queue_peak > 0 && sent.send_blocked_ns > 0 &&
+        recv.bytes_received == total && recv.messages_received > 0 &&
+        recv.bytes_sent == 0 &&
+        loop_stats.bytes_sent == total &&
+        loop_stats.bytes_received == total &&
+        loop_stats.messages_sent == kBuffers &&
+        loop_stats.messages_received == recv.messages_received &&
+        loop_stats.send_blocked_ns == sent.send_blocked_ns &&
+#ifdef __linux__
+        has_info && info.cwnd > 0 &&
+#endif
+        true ? 0 : 1;
+}
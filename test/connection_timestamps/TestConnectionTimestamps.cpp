@@ -0,0 +1,145 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "SocketOps.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <memory>
+
+namespace
+{
+
+const int kMessages = 10;
+const uint64_t kMaxDelayNs = 1000000000;
+
+// Connect a pair of TCP sockets through loopback.
+bool TcpPair(int fds[2])
+{
+    auto listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0)
+        return false;
+
+    struct sockaddr_in addr;
+    snet::SetSockAddrIn(&addr, "127.0.0.1", 0);
+    socklen_t len = sizeof(addr);
+
+    auto sa = reinterpret_cast<struct sockaddr *>(&addr);
+    bool ok = bind(listener, sa, sizeof(addr)) == 0 &&
+        listen(listener, 1) == 0 &&
+        getsockname(listener, sa, &len) == 0;
+
+    fds[0] = fds[1] = -1;
+    if (ok)
+    {
+        fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+        ok = fds[0] >= 0 && connect(fds[0], sa, sizeof(addr)) == 0;
+    }
+    if (ok)
+    {
+        fds[1] = accept(listener, nullptr, nullptr);
+        ok = fds[1] >= 0;
+    }
+
+    close(listener);
+    return ok && snet::SetSocketNonBlock(fds[0]) &&
+        snet::SetSocketNonBlock(fds[1]);
+}
+
+struct Result
+{
+    int sends = 0;
+    int send_timestamps = 0;
+    int recv_timestamps = 0;
+    bool valid = true;
+};
+
+} // namespace
+
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    int fds[2];
+    if (!TcpPair(fds))
+        return 1;
+
+    std::unique_ptr<snet::Connection> sender(
+        new snet::Connection(fds[0], loop));
+    std::unique_ptr<snet::Connection> receiver(
+        new snet::Connection(fds[1], loop));
+
+    if (!sender->EnableTimestamping() || !receiver->EnableTimestamping())
+    {
+        printf("timestamping is not supported\n");
+        return 0;
+    }
+
+    Result result;
+    sender->SetOnSendTimestamp(
+        [&result] (const snet::SendTimestamp &timestamp) {
+            printf("sent %llu bytes, left socket after %lldns\n",
+                   static_cast<unsigned long long>(timestamp.bytes),
+                   static_cast<long long>(
+                       timestamp.kernel_ns - timestamp.send_ns));
+
+            if (timestamp.bytes != ++result.send_timestamps * 4u ||
+                timestamp.kernel_ns < timestamp.send_ns ||
+                timestamp.kernel_ns - timestamp.send_ns > kMaxDelayNs)
+                result.valid = false;
+        });
+
+    receiver->SetOnReceivable([&] () {
+        char buf[64];
+        snet::Buffer buffer(buf, sizeof(buf));
+        if (receiver->Recv(&buffer) <= 0)
+            return ;
+
+        snet::RecvTimestamp timestamp;
+        if (!receiver->GetRecvTimestamp(&timestamp))
+            return ;
+
+        ++result.recv_timestamps;
+        printf("received, read after %lldns in kernel\n",
+               static_cast<long long>(
+                   timestamp.read_ns - timestamp.kernel_ns));
+
+        if (timestamp.read_ns < timestamp.kernel_ns ||
+            timestamp.read_ns - timestamp.kernel_ns > kMaxDelayNs)
+            result.valid = false;
+    });
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    // Send a message every millisecond, and give up after a second.
+    snet::Timer sending(&timer_list);
+    sending.SetOnTimeout([&] () {
+        if (result.sends < kMessages)
+        {
+            std::unique_ptr<snet::Buffer> buffer(
+                new snet::Buffer(new char[4](), 4, snet::OpDeleter));
+            sender->Send(std::move(buffer));
+            ++result.sends;
+        }
+        else if (result.send_timestamps == kMessages &&
+                 result.recv_timestamps > 0)
+        {
+            return loop->Stop();
+        }
+
+        sending.ExpireFromNow(snet::Milliseconds(1));
+    });
+    sending.ExpireFromNow(snet::Milliseconds(1));
+
+    snet::Timer timeout(&timer_list);
+    timeout.SetOnTimeout([loop] () { loop->Stop(); });
+    timeout.ExpireFromNow(snet::Seconds(1));
+
+    event_loop->Loop();
+
+    printf("send timestamps %d, recv timestamps %d\n",
+           result.send_timestamps, result.recv_timestamps);
+    return result.valid && result.send_timestamps == kMessages &&
+        result.recv_timestamps > 0 ? 0 : 1;
+}
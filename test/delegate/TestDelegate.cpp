@@ -0,0 +1,84 @@
+#include "Connection.h"
+#include "Delegate.h"
+#include "EventLoop.h"
+#include "SocketOps.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory>
+#include <new>
+
+namespace
+{
+
+int allocations = 0;
+int failures = 0;
+
+void Check(bool cond, const char *what)
+{
+    printf("%s: %s\n", what, cond ? "ok" : "failed");
+    if (!cond)
+        ++failures;
+}
+
+} // namespace
+
+void * operator new(std::size_t size)
+{
+    ++allocations;
+    auto p = malloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+int main()
+{
+    // Captures are moved with the delegate and destroyed by it.
+    auto shared = std::make_shared<int>(1);
+    {
+        snet::Delegate<int (int)> d1([shared] (int v) { return *shared + v; });
+        Check(shared.use_count() == 2, "capture copied into delegate");
+
+        auto d2 = std::move(d1);
+        Check(!d1 && d2 && d2(2) == 3, "delegate moved");
+        Check(shared.use_count() == 2, "capture moved with delegate");
+
+        d2 = nullptr;
+        Check(!d2 && shared.use_count() == 1, "delegate reset");
+    }
+
+    // Move-only arguments are forwarded.
+    snet::Delegate<int (std::unique_ptr<int>)> take(
+        [] (std::unique_ptr<int> p) { return *p; });
+    Check(take(std::unique_ptr<int>(new int(7))) == 7, "forward argument");
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return 1;
+
+    auto event_loop = snet::CreateEventLoop();
+    std::unique_ptr<snet::Connection> connection(
+        new snet::Connection(fds[0], event_loop.get()));
+
+    snet::TimerList timer_list;
+    snet::Timer timer(&timer_list);
+
+    // Setting callbacks of connection and timer does not allocate.
+    auto before = allocations;
+    auto weak = std::weak_ptr<int>(shared);
+    connection->SetOnReceivable([&connection, weak] () { });
+    connection->SetOnError([&connection, weak] () { });
+    timer.SetOnTimeout([&timer, &connection] () { });
+    Check(allocations == before, "set callbacks without allocation");
+
+    connection.reset();
+    close(fds[1]);
+
+    return failures == 0 ? 0 : 1;
+}
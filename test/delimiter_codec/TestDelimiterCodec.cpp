@@ -0,0 +1,167 @@
+#include "DelimiterCodec.h"
+#include "EventLoop.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const snet::ScanKernel kKernels[] = {
+    snet::ScanKernel::Scalar,
+    snet::ScanKernel::SSE2,
+    snet::ScanKernel::AVX2
+};
+
+// Every kernel finds the same positions as the scalar kernel, with
+// delimiters around the block boundaries of SSE2 and AVX2.
+bool TestKernels()
+{
+    const char *delimiters[] = { "\n", "\r\n", "|#|", "abcab", "0123456789" };
+
+    srand(1);
+    std::string data(4096, 'a');
+    for (auto &c : data)
+        c = "abc\r\n|#"[rand() % 7];
+
+    for (auto delimiter : delimiters)
+    {
+        snet::DelimiterScanner scalar(delimiter, snet::ScanKernel::Scalar);
+
+        for (auto kernel : kKernels)
+        {
+            if (!snet::IsScanKernelSupported(kernel))
+                continue;
+
+            snet::DelimiterScanner scanner(delimiter, kernel);
+            for (std::size_t begin = 0; begin < 70; ++begin)
+            {
+                for (std::size_t end = begin; end < 140; ++end)
+                {
+                    auto b = data.data() + begin;
+                    auto e = data.data() + end;
+                    if (scanner.Find(b, e) != scalar.Find(b, e))
+                    {
+                        printf("kernel %d delimiter %s [%zu, %zu): fail\n",
+                               static_cast<int>(kernel), delimiter,
+                               begin, end);
+                        return false;
+                    }
+                }
+            }
+
+            // Scan the whole data as DelimiterCodec does.
+            auto p = data.data();
+            auto end = p + data.size();
+            while (p < end)
+            {
+                auto found = scanner.Find(p, end);
+                if (found != scalar.Find(p, end))
+                    return false;
+                if (found == end)
+                    break;
+                p = found + scanner.Size();
+            }
+        }
+    }
+
+    return true;
+}
+
+bool TestEmptyDelimiter()
+{
+    try
+    {
+        snet::DelimiterScanner scanner("");
+    }
+    catch (const std::invalid_argument &)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+// Records are split across receives, and the delimiter itself is split
+// by two receives.
+bool TestCodec()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0 ||
+        !snet::SetSocketNonBlock(fds[0]))
+        return false;
+
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    snet::Connection connection(fds[0], loop);
+    snet::DelimiterCodec codec(&connection, "\r\n");
+
+    const std::vector<std::string> expected = {
+        "first", "", "split record", "split delimiter", "last"
+    };
+
+    std::vector<std::string> records;
+    bool error = false;
+    codec.SetOnRecord([&] (const snet::Record &record) {
+        records.emplace_back(record.data, record.size);
+        if (records.size() == expected.size())
+            loop->Stop();
+    });
+    codec.SetOnError([&] (snet::CodecE) {
+        error = true;
+        loop->Stop();
+    });
+
+    // Each chunk is written by a timer, so it is a receive of its own.
+    const char *chunks[] = {
+        "first\r\n\r\nsplit ", "record\r\nsplit delimiter\r", "\nlast\r\n"
+    };
+
+    std::vector<std::unique_ptr<snet::Timer>> timers;
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        auto chunk = chunks[i];
+        auto fd = fds[1];
+        timers.emplace_back(new snet::Timer(&timer_list));
+        timers.back()->SetOnTimeout([fd, chunk] () {
+            if (write(fd, chunk, strlen(chunk)) < 0)
+                perror("write");
+        });
+        timers.back()->ExpireFromNow(snet::Milliseconds(10 * (i + 1)));
+    }
+
+    snet::Timer timeout(&timer_list);
+    timeout.SetOnTimeout([loop] () { loop->Stop(); });
+    timeout.ExpireFromNow(snet::Milliseconds(2000));
+
+    event_loop->Loop();
+    close(fds[1]);
+
+    return !error && records == expected;
+}
+
+} // namespace
+
+int main()
+{
+    auto kernels = TestKernels();
+    auto empty = TestEmptyDelimiter();
+    auto codec = TestCodec();
+
+    printf("kernels match scalar: %s\n", kernels ? "ok" : "fail");
+    printf("empty delimiter rejected: %s\n", empty ? "ok" : "fail");
+    printf("records split: %s\n", codec ? "ok" : "fail");
+
+    return kernels && empty && codec ? 0 : 1;
+}
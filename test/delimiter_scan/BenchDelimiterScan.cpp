@@ -0,0 +1,139 @@
+#include "DelimiterCodec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+using FindFunc = std::function<const char * (const char *, const char *)>;
+
+std::vector<char> MakeLines(std::size_t size, const std::string &delimiter)
+{
+    std::vector<char> data;
+    data.reserve(size);
+
+    srand(0);
+    while (data.size() < size)
+    {
+        auto len = 40 + rand() % 160;
+        for (auto i = 0; i < len; ++i)
+            data.push_back(' ' + rand() % 90);
+        data.insert(data.end(), delimiter.begin(), delimiter.end());
+    }
+
+    return data;
+}
+
+const char * NaiveFind(const char *begin, const char *end,
+                       const std::string &delimiter)
+{
+    auto n = delimiter.size();
+    for (auto p = begin; p + n <= end; ++p)
+    {
+        std::size_t i = 0;
+        while (i < n && p[i] == delimiter[i])
+            ++i;
+        if (i == n)
+            return p;
+    }
+
+    return end;
+}
+
+const char * MemchrFind(const char *begin, const char *end,
+                        const std::string &delimiter)
+{
+    auto n = delimiter.size();
+    auto p = begin;
+
+    while (p + n <= end)
+    {
+        p = static_cast<const char *>(memchr(p, delimiter[0], end - p));
+        if (!p || p + n > end)
+            return end;
+        if (memcmp(p, delimiter.data(), n) == 0)
+            return p;
+        ++p;
+    }
+
+    return end;
+}
+
+void Bench(const char *name, const std::vector<char> &data,
+           std::size_t delimiter_size, const FindFunc &find)
+{
+    const int kRounds = 10;
+    std::size_t records = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < kRounds; ++i)
+    {
+        auto p = data.data();
+        auto end = data.data() + data.size();
+
+        while (true)
+        {
+            auto found = find(p, end);
+            if (found == end)
+                break;
+
+            ++records;
+            p = found + delimiter_size;
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        end - begin).count();
+    auto mb = static_cast<double>(data.size()) * kRounds / (1024 * 1024);
+
+    printf("  %-8s %10.1f MB/s  (%zu records)\n",
+           name, mb * 1000000 / us, records / kRounds);
+}
+
+void BenchDelimiter(const char *title, const std::string &delimiter)
+{
+    auto data = MakeLines(64 * 1024 * 1024, delimiter);
+    printf("%s:\n", title);
+
+    Bench("naive", data, delimiter.size(),
+          [&] (const char *b, const char *e) {
+              return NaiveFind(b, e, delimiter);
+          });
+    Bench("memchr", data, delimiter.size(),
+          [&] (const char *b, const char *e) {
+              return MemchrFind(b, e, delimiter);
+          });
+
+    struct { const char *name; snet::ScanKernel kernel; } kernels[] = {
+        { "scalar", snet::ScanKernel::Scalar },
+        { "sse2", snet::ScanKernel::SSE2 },
+        { "avx2", snet::ScanKernel::AVX2 },
+    };
+
+    for (auto &k : kernels)
+    {
+        if (!snet::IsScanKernelSupported(k.kernel))
+        {
+            printf("  %-8s not supported\n", k.name);
+            continue;
+        }
+
+        snet::DelimiterScanner scanner(delimiter, k.kernel);
+        Bench(k.name, data, delimiter.size(),
+              [&] (const char *b, const char *e) {
+                  return scanner.Find(b, e);
+              });
+    }
+}
+
+int main()
+{
+    BenchDelimiter("LF", "\n");
+    BenchDelimiter("CRLF", "\r\n");
+    BenchDelimiter("Record separator", "\r\n--\r\n");
+    return 0;
+}
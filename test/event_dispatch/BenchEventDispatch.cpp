@@ -0,0 +1,147 @@
+#include "Connection.h"
+#include "EventDispatcher.h"
+#include "EventLoop.h"
+#include "SocketOps.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#ifdef __APPLE__
+#include "KQueue.h"
+template<typename Dispatcher>
+using PlatformEventLoop = snet::BasicKQueue<Dispatcher>;
+#elif __linux__
+#include "Epoll.h"
+template<typename Dispatcher>
+using PlatformEventLoop = snet::BasicEpoll<Dispatcher>;
+#endif
+
+// Record handlers added to it, so the benchmark could call the handlers
+// of connections directly.
+class RecordLoop final : public snet::EventLoop
+{
+public:
+    virtual void AddEventHandler(snet::EventHandler *eh) override
+    {
+        handlers.push_back(eh);
+    }
+
+    virtual void DelEventHandler(snet::EventHandler *eh) override { }
+    virtual void UpdateEvents(snet::EventHandler *eh) override { }
+    virtual void AddLoopHandler(snet::LoopHandler *lh) override { }
+    virtual void DelLoopHandler(snet::LoopHandler *lh) override { }
+    virtual void Loop() override { }
+    virtual void Stop() override { }
+
+    std::vector<snet::EventHandler *> handlers;
+};
+
+template<typename Dispatcher>
+double BenchDispatch(const std::vector<snet::EventHandler *> &handlers,
+                     int rounds)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    long long sum = 0;
+    for (int i = 0; i < rounds; ++i)
+    {
+        for (auto eh : handlers)
+        {
+            sum += Dispatcher::Fd(eh);
+            sum += static_cast<int>(Dispatcher::EnabledEvents(eh));
+            Dispatcher::HandleRead(eh);
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        end - begin).count();
+
+    // Connections have fd -1 and read enabled.
+    if (sum != 0)
+        printf("unexpected sum of fds and events\n");
+
+    return static_cast<double>(ns) / (rounds * handlers.size());
+}
+
+// All connections are readable and never read, so every wait returns
+// ready events with level trigger.
+template<typename Dispatcher>
+double BenchLoop(int num, int iterations)
+{
+    PlatformEventLoop<Dispatcher> loop;
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return 0.0;
+
+    if (write(fds[1], "x", 1) != 1)
+        return 0.0;
+
+    long long events = 0;
+    std::vector<std::unique_ptr<snet::Connection>> connections;
+
+    for (int i = 0; i < num; ++i)
+    {
+        std::unique_ptr<snet::Connection> connection(
+            new snet::Connection(dup(fds[0]), &loop));
+        connection->SetOnReceivable(
+            [&] () {
+                if (++events == iterations)
+                    loop.Stop();
+            });
+        connections.push_back(std::move(connection));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    loop.Loop();
+    auto end = std::chrono::steady_clock::now();
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        end - begin).count();
+
+    connections.clear();
+    close(fds[0]);
+    close(fds[1]);
+
+    return static_cast<double>(ns) / events;
+}
+
+int main(int argc, const char **argv)
+{
+    int num = argc > 1 ? atoi(argv[1]) : 1000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10000;
+
+    long long reads = 0;
+    RecordLoop record_loop;
+    std::vector<std::unique_ptr<snet::Connection>> connections;
+
+    for (int i = 0; i < num; ++i)
+    {
+        std::unique_ptr<snet::Connection> connection(
+            new snet::Connection(-1, &record_loop));
+        connection->SetOnReceivable([&reads] () { ++reads; });
+        connections.push_back(std::move(connection));
+    }
+
+    auto virtual_ns = BenchDispatch<snet::VirtualEventDispatcher>(
+        record_loop.handlers, rounds);
+    auto default_ns = BenchDispatch<snet::DefaultEventDispatcher>(
+        record_loop.handlers, rounds);
+
+    printf("dispatch virtual:  %.2f ns/event\n", virtual_ns);
+    printf("dispatch default:  %.2f ns/event\n", default_ns);
+
+    auto iterations = num * 100;
+    auto loop_virtual_ns = BenchLoop<snet::VirtualEventDispatcher>(
+        num, iterations);
+    auto loop_default_ns = BenchLoop<snet::DefaultEventDispatcher>(
+        num, iterations);
+
+    printf("loop virtual:      %.2f ns/event\n", loop_virtual_ns);
+    printf("loop default:      %.2f ns/event\n", loop_default_ns);
+
+    return reads > 0 ? 0 : 1;
+}
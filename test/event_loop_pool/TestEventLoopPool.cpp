@@ -0,0 +1,207 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "EventLoopPool.h"
+#include "SocketOps.h"
+#include <poll.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const int kConnections = 8;
+
+using Clock = std::chrono::steady_clock;
+
+// Connections owned by each loop of the pool, callbacks of the pool run
+// in threads of loops concurrently.
+struct Connections
+{
+    std::mutex mutex;
+    std::map<snet::EventLoop *,
+             std::vector<std::unique_ptr<snet::Connection>>> loops;
+    std::atomic<bool> burning;
+    std::atomic<int> arrivals;
+
+    Connections()
+        : burning(true),
+          arrivals(0)
+    {
+    }
+
+    std::unique_ptr<snet::Connection> Release(snet::EventLoop *loop)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &connections = loops[loop];
+
+        std::unique_ptr<snet::Connection> connection;
+        if (!connections.empty())
+        {
+            connection = std::move(connections.back());
+            connections.pop_back();
+        }
+        return connection;
+    }
+
+    // Echo received data, burn CPU for each read under load.
+    void Own(snet::EventLoop *loop,
+             std::unique_ptr<snet::Connection> connection)
+    {
+        auto c = connection.get();
+        c->SetOnReceivable([this, c] () {
+            char buf[64];
+            snet::Buffer buffer(buf, sizeof(buf));
+            auto ret = c->Recv(&buffer);
+            if (ret <= 0)
+                return ;
+
+            auto end = Clock::now() + std::chrono::microseconds(500);
+            while (burning && Clock::now() < end)
+            {
+            }
+
+            auto data = new char[ret];
+            memcpy(data, buf, ret);
+            c->Send(std::unique_ptr<snet::Buffer>(
+                    new snet::Buffer(data, ret, snet::OpDeleter)));
+        });
+
+        ++arrivals;
+        std::lock_guard<std::mutex> lock(mutex);
+        loops[loop].push_back(std::move(connection));
+    }
+
+    std::size_t Count()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::size_t count = 0;
+        for (auto &loop : loops)
+            count += loop.second.size();
+        return count;
+    }
+};
+
+// Write a byte to each peer and wait for all echoes.
+bool Ping(const int *peers, int count, char byte)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (write(peers[i], &byte, 1) != 1)
+            return false;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        struct pollfd pfd;
+        pfd.fd = peers[i];
+        pfd.events = POLLIN;
+
+        char echo = 0;
+        if (poll(&pfd, 1, 2000) != 1 || read(peers[i], &echo, 1) != 1 ||
+            echo != byte)
+            return false;
+    }
+    return true;
+}
+
+template<typename Predicate>
+bool WaitFor(Predicate predicate, const int *peers, bool load)
+{
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (!predicate())
+    {
+        if (Clock::now() > deadline)
+            return false;
+
+        if (load)
+        {
+            if (!Ping(peers, kConnections, 'x'))
+                return false;
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    Connections connections;
+
+    snet::EventLoopPool::Options options;
+    options.min_loops = 1;
+    options.max_loops = 2;
+    options.interval = std::chrono::milliseconds(20);
+    options.grow_busy = 0.3;
+    options.shrink_busy = 0.05;
+    options.sustain = 2;
+
+    int peers[kConnections];
+    bool ok = true;
+
+    {
+        snet::EventLoopPool pool(
+            options,
+            [&connections] (snet::EventLoop *loop) {
+                return connections.Release(loop);
+            },
+            [&connections] (snet::EventLoop *loop,
+                            std::unique_ptr<snet::Connection> c) {
+                connections.Own(loop, std::move(c));
+            });
+
+        for (int i = 0; i < kConnections; ++i)
+        {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+                return 1;
+
+            snet::SetSocketNonBlock(fds[0]);
+            peers[i] = fds[1];
+            pool.AddConnection(std::unique_ptr<snet::Connection>(
+                    new snet::Connection(fds[0], nullptr)));
+        }
+
+        // Load grows the pool, then idle shrinks it again.
+        ok = WaitFor([&] () { return pool.GetLoopCount() == 2; },
+                     peers, true);
+        printf("grown to %zu loops: %s\n", pool.GetLoopCount(),
+               ok ? "ok" : "failed");
+
+        connections.burning = false;
+        ok = ok && WaitFor([&] () { return pool.GetLoopCount() == 1; },
+                           peers, false);
+        printf("shrunk to %zu loops: %s\n", pool.GetLoopCount(),
+               ok ? "ok" : "failed");
+
+        // Connections moved between loops still echo once all of them
+        // arrived.
+        ok = ok && WaitFor([&] () {
+                return connections.Count() == kConnections;
+            }, peers, false);
+        ok = ok && Ping(peers, kConnections, 'y');
+        printf("arrivals %d, connections %zu\n",
+               connections.arrivals.load(), connections.Count());
+    }
+
+    // Destroying the pool closes the connections.
+    for (int i = 0; i < kConnections; ++i)
+    {
+        char byte;
+        ok = ok && read(peers[i], &byte, 1) == 0;
+        close(peers[i]);
+    }
+
+    return ok && connections.Count() == 0 &&
+        connections.arrivals > kConnections ? 0 : 1;
+}
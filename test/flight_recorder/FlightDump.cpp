@@ -0,0 +1,35 @@
+#include "FlightRecorder.h"
+#include <stdio.h>
+
+// Convert a binary snapshot of FlightRecorder::WriteSnapshot into trace
+// JSON, which could be opened by chrome://tracing or ui.perfetto.dev.
+int main(int argc, const char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s snapshot [trace.json]\n", argv[0]);
+        return 1;
+    }
+
+    snet::FlightSnapshot snapshot;
+    if (!snet::FlightRecorder::ReadSnapshot(argv[1], &snapshot))
+    {
+        fprintf(stderr, "read snapshot %s failed\n", argv[1]);
+        return 1;
+    }
+
+    auto json = snet::FlightRecorder::ToChromeTrace(snapshot);
+
+    auto out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "open %s failed\n", argv[2]);
+        return 1;
+    }
+
+    auto ok = fwrite(json.data(), 1, json.size(), out) == json.size();
+    if (out != stdout)
+        ok = fclose(out) == 0 && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "FlightRecorder.h"
+#include "SocketOps.h"
+#include <stdio.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const std::size_t kCapacity = 1024;
+const uint32_t kRecords = 1000000;
+
+// Values of records of a thread are consecutive, so snapshots taken while
+// the rings wrap must not contain overwritten records.
+bool CheckConsecutive(const snet::FlightSnapshot &snapshot)
+{
+    for (auto &trace : snapshot.threads)
+    {
+        for (std::size_t i = 1; i < trace.records.size(); ++i)
+        {
+            auto &prev = trace.records[i - 1];
+            auto &record = trace.records[i];
+
+            if (record.fd != prev.fd ||
+                record.Value() != ((prev.Value() + 1) & 0xFFFFFF))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void WriteRecords(int id)
+{
+    for (uint32_t i = 0; i < kRecords; ++i)
+        snet::FlightRecorder::Record(snet::TraceEvent::BytesSent, id, i);
+}
+
+bool TestConcurrentSnapshots()
+{
+    std::atomic<bool> done(false);
+    std::thread writer1([] () { WriteRecords(1); });
+    std::thread writer2([] () { WriteRecords(2); });
+
+    int snapshots = 0;
+    auto ok = true;
+    std::thread reader([&] () {
+        while (!done)
+        {
+            ok = CheckConsecutive(snet::FlightRecorder::Snapshot()) && ok;
+            ++snapshots;
+        }
+    });
+
+    writer1.join();
+    writer2.join();
+    done = true;
+    reader.join();
+
+    auto snapshot = snet::FlightRecorder::Snapshot();
+    std::size_t records = 0;
+    for (auto &trace : snapshot.threads)
+        records += trace.records.size();
+
+    printf("%d snapshots while writing, %zu records kept of %zu threads\n",
+           snapshots, records, snapshot.threads.size());
+    return ok && CheckConsecutive(snapshot) && records == 2 * kCapacity;
+}
+
+#ifdef SNET_FLIGHT_RECORDER
+// Trace points of the event loop and connections are compiled in.
+bool TestLoopTrace()
+{
+    auto event_loop = snet::CreateEventLoop();
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return false;
+
+    snet::SetSocketNonBlock(fds[0]);
+    std::unique_ptr<snet::Connection> connection(
+        new snet::Connection(fds[0], event_loop.get()));
+
+    auto loop = event_loop.get();
+    connection->SetOnReceivable([&connection, loop] () {
+        char data[16];
+        snet::Buffer buffer(data, sizeof(data));
+        connection->Recv(&buffer);
+        loop->Stop();
+    });
+
+    if (write(fds[1], "x", 1) != 1)
+        return false;
+
+    std::thread([loop] () { loop->Loop(); }).join();
+    connection.reset();
+    close(fds[1]);
+
+    auto snapshot = snet::FlightRecorder::Snapshot();
+    int waits = 0, ready = 0, received = 0, closed = 0;
+
+    for (auto &trace : snapshot.threads)
+    {
+        for (auto &record : trace.records)
+        {
+            switch (record.Event())
+            {
+            case snet::TraceEvent::WaitBegin: ++waits; break;
+            case snet::TraceEvent::FdReady: ++ready; break;
+            case snet::TraceEvent::BytesReceived: ++received; break;
+            case snet::TraceEvent::ConnectionClosed: ++closed; break;
+            default: break;
+            }
+        }
+    }
+
+    printf("loop trace: %d waits, %d ready, %d received, %d closed\n",
+           waits, ready, received, closed);
+    return waits > 0 && ready > 0 && received == 1 && closed == 1;
+}
+#endif
+
+bool SameRecords(const snet::FlightSnapshot &l,
+                 const snet::FlightSnapshot &r)
+{
+    if (l.threads.size() != r.threads.size())
+        return false;
+
+    for (std::size_t i = 0; i < l.threads.size(); ++i)
+    {
+        auto &lr = l.threads[i].records;
+        auto &rr = r.threads[i].records;
+
+        if (l.threads[i].thread != r.threads[i].thread ||
+            lr.size() != rr.size())
+            return false;
+
+        for (std::size_t j = 0; j < lr.size(); ++j)
+        {
+            if (lr[j].tsc != rr[j].tsc || lr[j].fd != rr[j].fd ||
+                lr[j].event_value != rr[j].event_value)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// No thread records now, so the snapshot file has the same records.
+bool TestSnapshotFile()
+{
+    const char *path = "flight_recorder.snapshot";
+    auto expected = snet::FlightRecorder::Snapshot();
+    if (!snet::FlightRecorder::WriteSnapshot(path))
+        return false;
+
+    snet::FlightSnapshot snapshot;
+    auto ok = snet::FlightRecorder::ReadSnapshot(path, &snapshot);
+    unlink(path);
+
+    auto json = snet::FlightRecorder::ToChromeTrace(snapshot);
+    printf("trace json of %zu bytes\n", json.size());
+
+    return ok && SameRecords(expected, snapshot) &&
+        json.compare(0, 15, "{\"displayTimeUn") == 0 &&
+        json.find("\"name\":\"sent\"") != std::string::npos;
+}
+
+} // namespace
+
+int main()
+{
+    snet::FlightRecorder::SetRingCapacity(kCapacity);
+
+    auto ok = TestConcurrentSnapshots();
+#ifdef SNET_FLIGHT_RECORDER
+    ok = TestLoopTrace() && ok;
+#endif
+    ok = TestSnapshotFile() && ok;
+
+    printf("flight recorder: %s\n", ok ? "ok" : "failed");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "SocketOps.h"
+#include <stdio.h>
+#include <memory>
+#include <vector>
+
+namespace
+{
+
+const int kConnections = 200;
+
+std::vector<std::unique_ptr<snet::Connection>> connections;
+std::vector<int> peers;
+int calls = 0;
+int stale_calls = 0;
+int reused_fds = 0;
+
+class StopAfterOneLoop final : public snet::LoopHandler
+{
+public:
+    explicit StopAfterOneLoop(snet::EventLoop *loop)
+        : loop_(loop)
+    {
+    }
+
+    virtual void HandleLoop() override
+    {
+        loop_->Stop();
+    }
+
+    virtual void HandleStop() override { }
+
+private:
+    snet::EventLoop *loop_;
+};
+
+std::unique_ptr<snet::Connection> NewConnection(snet::EventLoop *loop,
+                                                bool readable)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return nullptr;
+
+    snet::SetSocketNonBlock(fds[0]);
+    peers.push_back(fds[1]);
+
+    if (readable && write(fds[1], "x", 1) != 1)
+        return nullptr;
+
+    return std::unique_ptr<snet::Connection>(
+        new snet::Connection(fds[0], loop));
+}
+
+// Delete the next connection and create a new one which usually gets the
+// same fd, pending event of the deleted one must not reach the new one.
+void HandleReceivable(snet::EventLoop *loop, int index)
+{
+    ++calls;
+
+    char data[16];
+    snet::Buffer buffer(data, sizeof(data));
+    connections[index]->Recv(&buffer);
+
+    auto next = index + 1;
+    if (index % 2 != 0 || next >= kConnections)
+        return ;
+
+    auto fd = connections[next]->Fd();
+    connections[next].reset();
+
+    connections[next] = NewConnection(loop, false);
+    if (connections[next]->Fd() == fd)
+        ++reused_fds;
+
+    connections[next]->SetOnReceivable([] () { ++stale_calls; });
+}
+
+} // namespace
+
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    for (int i = 0; i < kConnections; ++i)
+    {
+        connections.push_back(NewConnection(loop, true));
+        connections.back()->SetOnReceivable(
+            [loop, i] () { HandleReceivable(loop, i); });
+    }
+
+    StopAfterOneLoop stop(loop);
+    event_loop->AddLoopHandler(&stop);
+    event_loop->Loop();
+
+    printf("calls: %d, reused fds: %d, stale calls: %d\n",
+           calls, reused_fds, stale_calls);
+
+    connections.clear();
+    for (auto fd : peers)
+        close(fd);
+
+    return stale_calls == 0 && calls == kConnections / 2 ? 0 : 1;
+}
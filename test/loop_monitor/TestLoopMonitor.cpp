@@ -0,0 +1,119 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "LoopMonitor.h"
+#include "SocketOps.h"
+#include "Timer.h"
+#include "Watchdog.h"
+#include <stdio.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const int kWrites = 10;
+const int kSlowRead = 5;
+
+struct Stalls
+{
+    std::mutex mutex;
+    std::vector<snet::Watchdog::Stall> stalls;
+};
+
+void PrintHistogram(const snet::LoopMonitor &monitor, snet::CallbackSite site)
+{
+    auto &histogram = monitor.Histogram(site);
+    printf("%-6s count %4llu  p50 %9llu ns  p99 %9llu ns  max %9llu ns\n",
+           snet::CallbackSiteName(site),
+           static_cast<unsigned long long>(histogram.Count()),
+           static_cast<unsigned long long>(histogram.Percentile(50)),
+           static_cast<unsigned long long>(histogram.Percentile(99)),
+           static_cast<unsigned long long>(histogram.Max()));
+}
+
+} // namespace
+
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    snet::LoopMonitor monitor;
+    loop->SetMonitor(&monitor);
+
+    Stalls stalls;
+    snet::Watchdog watchdog(
+        snet::Milliseconds(20),
+        [&stalls] (const snet::Watchdog::Stall &stall) {
+            std::lock_guard<std::mutex> lock(stalls.mutex);
+            stalls.stalls.push_back(stall);
+        });
+    watchdog.Watch(&monitor);
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    loop->AddLoopHandler(&timer_driver);
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return 1;
+
+    snet::SetSocketNonBlock(fds[0]);
+    std::unique_ptr<snet::Connection> connection(
+        new snet::Connection(fds[0], loop));
+
+    // One read callback blocks the loop.
+    int reads = 0;
+    connection->SetOnReceivable([&connection, &reads, loop] () {
+        char data[16];
+        snet::Buffer buffer(data, sizeof(data));
+        if (connection->Recv(&buffer) <= 0)
+            return ;
+
+        if (++reads == kSlowRead)
+            std::this_thread::sleep_for(snet::Milliseconds(60));
+        if (reads == kWrites)
+            loop->Stop();
+    });
+
+    int writes = 0;
+    auto peer = fds[1];
+    snet::Timer writer(&timer_list);
+    writer.SetOnTimeout([&writer, &writes, peer] () {
+        if (write(peer, "x", 1) == 1 && ++writes < kWrites)
+            writer.ExpireFromNow(snet::Milliseconds(1));
+    });
+    writer.ExpireFromNow(snet::Milliseconds(1));
+
+    loop->Loop();
+    watchdog.Unwatch(&monitor);
+
+    PrintHistogram(monitor, snet::CallbackSite::Read);
+    PrintHistogram(monitor, snet::CallbackSite::Loop);
+    PrintHistogram(monitor, snet::CallbackSite::Timer);
+
+    std::lock_guard<std::mutex> lock(stalls.mutex);
+    auto found = false;
+    for (auto &stall : stalls.stalls)
+    {
+        printf("stall: %llu ns in %s callback of fd %d\n",
+               static_cast<unsigned long long>(stall.busy_ns),
+               snet::CallbackSiteName(stall.site), stall.fd);
+
+        if (stall.site == snet::CallbackSite::Read && stall.fd == fds[0])
+            found = true;
+    }
+
+    auto &read = monitor.Histogram(snet::CallbackSite::Read);
+    auto ok = found && read.Count() == kWrites &&
+        read.Max() >= 60 * 1000 * 1000 &&
+        read.Percentile(50) < 1000 * 1000 &&
+        monitor.Histogram(snet::CallbackSite::Timer).Count() == kWrites;
+
+    connection.reset();
+    close(fds[1]);
+
+    return ok ? 0 : 1;
+}
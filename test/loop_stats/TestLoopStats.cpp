@@ -0,0 +1,127 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "SocketOps.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace
+{
+
+const int kWrites = 20;
+
+void Print(const char *name, uint64_t value)
+{
+    printf("%-16s %llu\n", name, static_cast<unsigned long long>(value));
+}
+
+} // namespace
+
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return 1;
+
+    snet::SetSocketNonBlock(fds[0]);
+    std::unique_ptr<snet::Connection> connection(
+        new snet::Connection(fds[0], loop));
+
+    int reads = 0;
+    connection->SetOnReceivable([&] () {
+        char data[16];
+        snet::Buffer buffer(data, sizeof(data));
+        if (connection->Recv(&buffer) > 0)
+            ++reads;
+    });
+
+    // Write the peer every millisecond, then block the loop while the
+    // last timer is due, so it is fired late.
+    struct Timers
+    {
+        explicit Timers(snet::TimerList *timer_list)
+            : writer(timer_list), blocker(timer_list), last(timer_list)
+        {
+        }
+
+        snet::Timer writer;
+        snet::Timer blocker;
+        snet::Timer last;
+        int peer = -1;
+        int writes = 0;
+    };
+
+    Timers timers(&timer_list);
+    timers.peer = fds[1];
+
+    timers.writer.SetOnTimeout([&timers] () {
+        if (write(timers.peer, "x", 1) == 1 && ++timers.writes < kWrites)
+        {
+            timers.writer.ExpireFromNow(snet::Milliseconds(1));
+            return ;
+        }
+
+        timers.blocker.ExpireFromNow(snet::Milliseconds(1));
+    });
+
+    timers.blocker.SetOnTimeout([&timers] () {
+        timers.last.ExpireFromNow(snet::Milliseconds(1));
+        std::this_thread::sleep_for(snet::Milliseconds(40));
+    });
+
+    timers.last.SetOnTimeout([loop] () { loop->Stop(); });
+    timers.writer.ExpireFromNow(snet::Milliseconds(1));
+
+    // Stats are read from another thread while the loop runs.
+    std::atomic<bool> done(false);
+    bool monotonic = true;
+    std::thread reader([&] () {
+        uint64_t iterations = 0;
+        while (!done)
+        {
+            auto stats = loop->GetStats();
+            if (stats.iterations < iterations)
+                monotonic = false;
+            iterations = stats.iterations;
+        }
+    });
+
+    event_loop->Loop();
+    done = true;
+    reader.join();
+
+    auto stats = loop->GetStats();
+    Print("iterations", stats.iterations);
+    Print("events", stats.events);
+    Print("blocked_ns", stats.blocked_ns);
+    Print("busy_ns", stats.busy_ns);
+    Print("callbacks", stats.callbacks);
+    Print("ctl_calls", stats.ctl_calls);
+    Print("handlers", stats.handlers);
+    Print("timers_pending", stats.timers_pending);
+    Print("late_timers", stats.late_timers);
+
+    connection.reset();
+    close(fds[1]);
+
+    auto handlers = loop->GetStats().handlers;
+    printf("handlers after close: %llu\n",
+           static_cast<unsigned long long>(handlers));
+
+    return monotonic && reads == kWrites &&
+        stats.events >= static_cast<uint64_t>(kWrites) &&
+        stats.callbacks >= static_cast<uint64_t>(kWrites) &&
+        stats.ctl_calls >= 1 && stats.handlers == 1 &&
+        stats.busy_ns >= 40 * 1000 * 1000 &&
+        stats.timers_pending == 0 && stats.late_timers >= 1 &&
+        handlers == 0 ? 0 : 1;
+}
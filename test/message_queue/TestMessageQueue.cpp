@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <thread>
 #include <memory>
+#include <vector>
 
 class Consumer
 {
@@ -54,6 +55,36 @@ private:
                 printf("TryRecv msg %d\n", *v);
             }
         }
+
+        while (true)
+        {
+            std::unique_ptr<int> v;
+            if (msg_queue_.TryRecv(&v))
+            {
+                if (!v)
+                    break;
+
+                printf("TryRecv into msg %d\n", *v);
+            }
+        }
+
+        std::vector<std::unique_ptr<int>> batch;
+        bool done = false;
+        while (!done)
+        {
+            msg_queue_.DrainInto(&batch);
+            for (auto &v : batch)
+            {
+                if (!v)
+                {
+                    done = true;
+                    break;
+                }
+
+                printf("DrainInto msg %d\n", *v);
+            }
+            batch.clear();
+        }
     }
 
     snet::MessageQueue<std::unique_ptr<int>> msg_queue_;
@@ -74,5 +105,15 @@ int main()
 
     c.SendNull();
 
+    for (int i = 0; i < 10; ++i)
+        c.Send(i);
+
+    c.SendNull();
+
+    for (int i = 0; i < 10; ++i)
+        c.Send(i);
+
+    c.SendNull();
+
     return 0;
 }
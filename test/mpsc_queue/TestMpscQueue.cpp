@@ -0,0 +1,83 @@
+#include "MpscQueue.h"
+#include <stdio.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const int kProducers = 4;
+const int kMessages = 100000;
+
+struct Message : snet::MpscNode
+{
+    int producer;
+    int sequence;
+};
+
+} // namespace
+
+int main()
+{
+    snet::MpscQueue<Message> queue;
+
+    if (queue.TryRecv())
+    {
+        printf("empty queue: fail\n");
+        return 1;
+    }
+
+    // Messages are preallocated, the queue never allocates.
+    std::vector<std::unique_ptr<Message []>> messages;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        messages.emplace_back(new Message[kMessages]);
+        for (int i = 0; i < kMessages; ++i)
+        {
+            messages[p][i].producer = p;
+            messages[p][i].sequence = i;
+        }
+    }
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        producers.emplace_back([&queue, &messages, p] () {
+            for (int i = 0; i < kMessages; ++i)
+                queue.Send(&messages[p][i]);
+        });
+    }
+
+    // Messages of each producer are received in the order they are sent.
+    std::vector<int> next(kProducers, 0);
+    int received = 0;
+    bool ordered = true;
+
+    while (received < kProducers * kMessages)
+    {
+        auto message = queue.TryRecv();
+        if (!message)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (message->sequence != next[message->producer]++)
+            ordered = false;
+        ++received;
+    }
+
+    for (auto &producer : producers)
+        producer.join();
+
+    printf("received %d messages: %s\n", received, ordered ? "ok" : "fail");
+    printf("drained: %s\n", queue.TryRecv() ? "fail" : "ok");
+
+    // Queue is reusable after it is drained.
+    queue.Send(&messages[0][0]);
+    auto message = queue.TryRecv();
+    printf("reuse: %s\n", message == &messages[0][0] ? "ok" : "fail");
+
+    return ordered && !queue.TryRecv() && message == &messages[0][0] ? 0 : 1;
+}
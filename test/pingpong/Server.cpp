@@ -1,4 +1,5 @@
 #include "Acceptor.h"
+#include "Affinity.h"
 #include "Connection.h"
 #include "EventLoop.h"
 #include "SocketOps.h"
@@ -9,12 +10,14 @@
 #include <memory>
 #include <thread>
 #include <set>
+#include <vector>
 
 class Worker final
 {
 public:
-    Worker()
+    explicit Worker(int cpu)
         : connection_getter_(this),
+          cpu_(cpu),
           thread_(&Worker::ThreadFunc, this)
     {
     }
@@ -47,19 +50,25 @@ private:
 
         virtual void HandleLoop() override
         {
-            auto msg = worker_->message_queue_.TryRecv();
-            if (msg)
-                worker_->AddNewConnection(std::move(*msg));
+            if (worker_->message_queue_.DrainInto(&connections_) == 0)
+                return ;
+
+            for (auto &connection : connections_)
+                worker_->AddNewConnection(std::move(connection));
+            connections_.clear();
         }
 
         virtual void HandleStop() override { }
 
     private:
         Worker *worker_;
+        std::vector<std::unique_ptr<snet::Connection>> connections_;
     };
 
     void ThreadFunc()
     {
+        if (!snet::PinCurrentThreadToCpu(cpu_))
+            fprintf(stderr, "Pin worker to cpu %d failed\n", cpu_);
         event_loop_ = snet::CreateEventLoop();
         event_loop_->AddLoopHandler(&connection_getter_);
         event_loop_->Loop();
@@ -132,6 +141,7 @@ private:
     ConnectionSet connection_set_;
     ConnectionGetter connection_getter_;
     std::unique_ptr<snet::EventLoop> event_loop_;
+    int cpu_;
     std::thread thread_;
 };
 
@@ -140,7 +150,6 @@ class Server final
 public:
     Server(snet::EventLoop *loop, int worker_num)
         : worker_num_(worker_num),
-          next_worker_(0),
           loop_(loop)
     {
     }
@@ -157,10 +166,16 @@ public:
                 AddNewConnection(std::move(connection));
             });
 
+        // Workers are pinned to the CPUs the process may run on in turn,
+        // connections go to the worker on the CPU which received their
+        // packets.
+        auto cpus = snet::GetAllowedCpus();
         for (int i = 0; i < worker_num_; ++i)
         {
-            WorkerPtr worker(new Worker);
+            auto cpu = cpus[i % cpus.size()];
+            WorkerPtr worker(new Worker(cpu));
             worker_list_.push_back(std::move(worker));
+            cpu_loop_map_.AddLoop(i, cpu);
         }
         return true;
     }
@@ -171,15 +186,14 @@ private:
 
     void AddNewConnection(std::unique_ptr<snet::Connection> connection)
     {
-        auto index = next_worker_++;
-        next_worker_ = next_worker_ % worker_num_;
+        auto index = cpu_loop_map_.FindLoop(connection->GetIncomingCpu());
         worker_list_[index]->AddConnection(std::move(connection));
     }
 
     int worker_num_;
-    int next_worker_;
     snet::EventLoop *loop_;
     WorkerList worker_list_;
+    snet::CpuLoopMap cpu_loop_map_;
     std::unique_ptr<snet::Acceptor> acceptor_;
 };
 
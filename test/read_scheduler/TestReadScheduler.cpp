@@ -0,0 +1,157 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "ReadScheduler.h"
+#include "SocketOps.h"
+#include <errno.h>
+#include <stdio.h>
+#include <memory>
+#include <vector>
+
+namespace
+{
+
+const std::size_t kBytesPerRound = 4096;
+const unsigned int kWeight = 4;
+
+// Reader drains its connection in each callback as usual, the scheduler
+// bounds how much it gets.
+struct Reader
+{
+    std::unique_ptr<snet::Connection> connection;
+    int peer = -1;
+    std::size_t filled = 0;
+    std::size_t received = 0;
+    std::size_t max_per_call = 0;
+    int done_round = 0;
+};
+
+int round = 0;
+int small_round = 0;
+
+class RoundCounter final : public snet::LoopHandler
+{
+public:
+    RoundCounter(snet::EventLoop *loop, Reader *hot, Reader *weighted)
+        : loop_(loop), hot_(hot), weighted_(weighted)
+    {
+    }
+
+    virtual void HandleLoop() override
+    {
+        ++round;
+        if (hot_->done_round && weighted_->done_round && small_round)
+            loop_->Stop();
+    }
+
+    virtual void HandleStop() override { }
+
+private:
+    snet::EventLoop *loop_;
+    Reader *hot_;
+    Reader *weighted_;
+};
+
+// Fill the socket until it is full, return the bytes written.
+std::size_t Fill(int fd, std::size_t limit)
+{
+    char data[4096] = { 0 };
+    std::size_t filled = 0;
+
+    while (filled < limit)
+    {
+        auto len = std::min(sizeof(data), limit - filled);
+        auto ret = write(fd, data, len);
+        if (ret <= 0)
+            break;
+        filled += ret;
+    }
+
+    return filled;
+}
+
+bool Open(snet::EventLoop *loop, Reader *reader)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return false;
+
+    snet::SetSocketNonBlock(fds[0]);
+    snet::SetSocketNonBlock(fds[1]);
+    reader->connection.reset(new snet::Connection(fds[0], loop));
+    reader->peer = fds[1];
+    return true;
+}
+
+void HandleReceivable(Reader *reader)
+{
+    char data[65536];
+    std::size_t bytes = 0;
+
+    for (;;)
+    {
+        snet::Buffer buffer(data, sizeof(data));
+        auto ret = reader->connection->Recv(&buffer);
+        if (ret <= 0)
+            break;
+        bytes += ret;
+    }
+
+    reader->received += bytes;
+    reader->max_per_call = std::max(reader->max_per_call, bytes);
+
+    if (reader->received == reader->filled && !reader->done_round)
+        reader->done_round = round + 1;
+}
+
+} // namespace
+
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    snet::ReadScheduler scheduler(kBytesPerRound, 0);
+    auto group = scheduler.AddGroup(kWeight);
+    event_loop->AddLoopHandler(&scheduler);
+
+    Reader hot, weighted, small;
+    if (!Open(loop, &hot) || !Open(loop, &weighted) || !Open(loop, &small))
+        return 1;
+
+    hot.filled = Fill(hot.peer, 128 * 1024);
+    weighted.filled = Fill(weighted.peer, hot.filled);
+    small.filled = Fill(small.peer, 1);
+
+    hot.connection->SetReadScheduler(&scheduler);
+    weighted.connection->SetReadScheduler(&scheduler, group);
+    small.connection->SetReadScheduler(&scheduler);
+
+    hot.connection->SetOnReceivable([&hot] () { HandleReceivable(&hot); });
+    weighted.connection->SetOnReceivable(
+        [&weighted] () { HandleReceivable(&weighted); });
+    small.connection->SetOnReceivable([&small] () {
+        HandleReceivable(&small);
+        if (!small_round)
+            small_round = round + 1;
+    });
+
+    RoundCounter counter(loop, &hot, &weighted);
+    event_loop->AddLoopHandler(&counter);
+    event_loop->Loop();
+
+    printf("filled %zu bytes of each hot connection\n", hot.filled);
+    printf("hot max bytes per call: %zu, done in round %d\n",
+           hot.max_per_call, hot.done_round);
+    printf("weighted max bytes per call: %zu, done in round %d\n",
+           weighted.max_per_call, weighted.done_round);
+    printf("small served in round %d\n", small_round);
+
+    close(hot.peer);
+    close(weighted.peer);
+    close(small.peer);
+
+    return hot.max_per_call <= kBytesPerRound &&
+        weighted.max_per_call <= kBytesPerRound * kWeight &&
+        hot.done_round > weighted.done_round &&
+        small_round == 1 ? 0 : 1;
+}
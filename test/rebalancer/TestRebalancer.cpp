@@ -0,0 +1,225 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "LoopTasks.h"
+#include "ReadScheduler.h"
+#include "Rebalancer.h"
+#include "SendQueueBudget.h"
+#include "SocketOps.h"
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const int kConnections = 4;
+const std::size_t kSendBytes = 1024 * 1024;
+const std::size_t kReadBytes = 64 * 1024;
+const std::size_t kBudget = 1024 * 1024 * 1024;
+
+// Keep a loop busy while burning is set.
+class Burner final : public snet::LoopHandler
+{
+public:
+    Burner()
+        : burning(true)
+    {
+    }
+
+    virtual void HandleLoop() override
+    {
+        auto end = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(2);
+        while (burning && std::chrono::steady_clock::now() < end)
+        {
+        }
+    }
+
+    virtual void HandleStop() override { }
+
+    virtual bool HasPendingWork() const override
+    {
+        return burning;
+    }
+
+    std::atomic<bool> burning;
+};
+
+// Connections owned by a loop, only touched in the thread of the loop.
+struct Worker
+{
+    std::unique_ptr<snet::EventLoop> loop = snet::CreateEventLoop();
+    snet::LoopTasks tasks;
+    snet::ReadScheduler scheduler{kReadBytes, 0};
+    snet::SendQueueBudget budget{kBudget};
+    std::vector<std::unique_ptr<snet::Connection>> connections;
+    std::thread::id thread;
+    int reads = 0;
+    int foreign_reads = 0;
+
+    void Own(std::unique_ptr<snet::Connection> connection)
+    {
+        auto c = connection.get();
+        c->SetOnReceivable([this, c] () {
+            char buf[16];
+            snet::Buffer buffer(buf, sizeof(buf));
+            if (c->Recv(&buffer) <= 0)
+                return ;
+
+            ++reads;
+            if (std::this_thread::get_id() != thread)
+                ++foreign_reads;
+        });
+        connections.push_back(std::move(connection));
+    }
+
+    std::unique_ptr<snet::Connection> Release()
+    {
+        std::unique_ptr<snet::Connection> connection;
+        if (!connections.empty())
+        {
+            connection = std::move(connections.back());
+            connections.pop_back();
+        }
+        return connection;
+    }
+
+    void Run()
+    {
+        thread = std::this_thread::get_id();
+        loop->AddLoopHandler(&tasks);
+        loop->AddLoopHandler(&scheduler);
+        loop->AddLoopHandler(&budget);
+        loop->Loop();
+        loop->DelLoopHandler(&budget);
+        loop->DelLoopHandler(&scheduler);
+        loop->DelLoopHandler(&tasks);
+    }
+};
+
+// Read all bytes from fd until nothing arrives for a while.
+std::size_t Drain(int fd)
+{
+    std::size_t total = 0;
+    auto idle_since = std::chrono::steady_clock::now();
+    char buf[64 * 1024];
+
+    while (std::chrono::steady_clock::now() - idle_since <
+           std::chrono::milliseconds(200))
+    {
+        auto bytes = read(fd, buf, sizeof(buf));
+        if (bytes > 0)
+        {
+            total += bytes;
+            idle_since = std::chrono::steady_clock::now();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return total;
+}
+
+} // namespace
+
+int main()
+{
+    Worker busy;
+    Worker idle;
+    Burner burner;
+    busy.loop->AddLoopHandler(&burner);
+
+    // Connections of the busy loop have data queued when they move.
+    int peers[kConnections];
+    for (int i = 0; i < kConnections; ++i)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+            return 1;
+
+        snet::SetSocketNonBlock(fds[0]);
+        snet::SetSocketNonBlock(fds[1]);
+        peers[i] = fds[1];
+
+        std::unique_ptr<snet::Connection> connection(
+            new snet::Connection(fds[0], busy.loop.get()));
+        connection->SetReadScheduler(&busy.scheduler);
+        connection->SetSendQueueBudget(&busy.budget);
+        connection->Send(std::unique_ptr<snet::Buffer>(new snet::Buffer(
+                    new char[kSendBytes](), kSendBytes, snet::OpDeleter)));
+        busy.Own(std::move(connection));
+    }
+
+    std::thread busy_thread(&Worker::Run, &busy);
+    std::thread idle_thread(&Worker::Run, &idle);
+
+    {
+        snet::Rebalancer rebalancer(std::chrono::milliseconds(20), 0.3);
+        rebalancer.AddLoop(busy.loop.get(), &busy.tasks,
+                           [&busy] () { return busy.Release(); },
+                           [&busy] (std::unique_ptr<snet::Connection> c) {
+                               busy.Own(std::move(c));
+                           }, &busy.scheduler, &busy.budget);
+        rebalancer.AddLoop(idle.loop.get(), &idle.tasks,
+                           [&idle] () { return idle.Release(); },
+                           [&idle] (std::unique_ptr<snet::Connection> c) {
+                               idle.Own(std::move(c));
+                           }, &idle.scheduler, &idle.budget);
+
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::seconds(5);
+        while (rebalancer.GetMoves() < 2 &&
+               std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+        burner.burning = false;
+        printf("moves %zu\n", rebalancer.GetMoves());
+
+        // Moved connections keep their send queues.
+        bool complete = true;
+        for (int i = 0; i < kConnections; ++i)
+        {
+            auto bytes = Drain(peers[i]);
+            printf("peer %d received %zu bytes\n", i, bytes);
+            complete = complete && bytes == kSendBytes;
+
+            if (write(peers[i], "x", 1) != 1)
+                complete = false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        busy.tasks.Post([&busy] () { busy.loop->Stop(); });
+        idle.tasks.Post([&idle] () { idle.loop->Stop(); });
+        busy_thread.join();
+        idle_thread.join();
+
+        printf("busy loop owns %zu, idle loop owns %zu\n",
+               busy.connections.size(), idle.connections.size());
+        printf("reads %d, reads in foreign threads %d\n",
+               busy.reads + idle.reads,
+               busy.foreign_reads + idle.foreign_reads);
+
+        // Moved connections are under the budget of their new loop.
+        printf("budgeted by busy loop %zu, by idle loop %zu\n",
+               busy.budget.GetConnections(), idle.budget.GetConnections());
+
+        if (!complete || rebalancer.GetMoves() < 2 ||
+            idle.connections.empty() ||
+            busy.connections.size() + idle.connections.size() !=
+            kConnections ||
+            busy.reads + idle.reads != kConnections ||
+            busy.foreign_reads + idle.foreign_reads != 0 ||
+            busy.budget.GetConnections() != busy.connections.size() ||
+            idle.budget.GetConnections() != idle.connections.size())
+            return 1;
+    }
+
+    busy.loop->DelLoopHandler(&burner);
+    for (auto peer : peers)
+        close(peer);
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "SocketOps.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+
+namespace
+{
+
+const std::size_t kHeadSize = 64 * 1024;
+const std::size_t kTailSize = 8 * 1024;
+const std::size_t kFileSize = 512 * 1024;
+const off_t kFileOffset = 100;
+const std::size_t kSegmentSize = 256 * 1024;
+const std::size_t kTotal = kHeadSize + kSegmentSize + kTailSize;
+
+// Byte at offset of the stream, the file segment starts at kFileOffset.
+char Expected(std::size_t offset)
+{
+    if (offset < kHeadSize)
+        return 'h';
+    if (offset >= kHeadSize + kSegmentSize)
+        return 't';
+
+    auto file_offset = offset - kHeadSize + kFileOffset;
+    return static_cast<char>(file_offset % 251);
+}
+
+int CreateFile()
+{
+    char path[] = "/tmp/snet_send_file_XXXXXX";
+    auto fd = mkstemp(path);
+    if (fd < 0)
+        return -1;
+    unlink(path);
+
+    std::string data(kFileSize, 0);
+    for (std::size_t i = 0; i < kFileSize; ++i)
+        data[i] = static_cast<char>(i % 251);
+
+    if (write(fd, data.data(), data.size()) !=
+        static_cast<ssize_t>(data.size()))
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+bool SocketPair(int fds[2])
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return false;
+
+    int size = 16 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    return snet::SetSocketNonBlock(fds[0]) && snet::SetSocketNonBlock(fds[1]);
+}
+
+void SendFill(snet::Connection *connection, std::size_t size, char c)
+{
+    std::unique_ptr<snet::Buffer> buffer(
+        new snet::Buffer(new char[size], size, snet::OpDeleter));
+    for (std::size_t i = 0; i < size; ++i)
+        buffer->buf[i] = c;
+    connection->Send(std::move(buffer));
+}
+
+struct State
+{
+    snet::EventLoop *loop = nullptr;
+    snet::Connection *sender = nullptr;
+    int peer = -1;
+    snet::Timer *tick = nullptr;
+
+    std::size_t received = 0;
+    bool data_valid = true;
+
+    // Ticks which saw the file segment partially sent.
+    int partial_file_ticks = 0;
+    int send_completes = 0;
+    bool complete_after_file = false;
+    bool complete_with_empty_queue = false;
+
+    // Peer reads a little every tick, so the sender keeps hitting EAGAIN
+    // and resumes the file segment from where sendfile stopped.
+    void Tick()
+    {
+        auto queued = sender->GetQueuedSendBytes();
+        if (queued > kTailSize && queued < kTailSize + kSegmentSize)
+            ++partial_file_ticks;
+
+        char buf[8 * 1024];
+        auto ret = read(peer, buf, sizeof(buf));
+        for (ssize_t i = 0; i < ret; ++i, ++received)
+        {
+            if (buf[i] != Expected(received))
+                data_valid = false;
+        }
+
+        if (received == kTotal)
+            return loop->Stop();
+
+        tick->ExpireFromNow(snet::Milliseconds(1));
+    }
+};
+
+} // namespace
+
+// Buffer queued ahead of a file segment is sent first, the segment is
+// sent by several partial sendfile calls as the peer reads, the buffer
+// after it follows, and OnSendComplete is called once after all of them.
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    auto file = CreateFile();
+    int fds[2];
+    if (file < 0 || !SocketPair(fds))
+        return 1;
+
+    std::unique_ptr<snet::Connection> sender(
+        new snet::Connection(fds[0], loop));
+
+    State st;
+    auto s = &st;
+    st.loop = loop;
+    st.sender = sender.get();
+    st.peer = fds[1];
+
+    sender->SetOnSendComplete([s] () {
+        ++s->send_completes;
+        s->complete_after_file = s->partial_file_ticks > 1;
+        s->complete_with_empty_queue = s->sender->GetQueuedSendBytes() == 0;
+    });
+
+    SendFill(sender.get(), kHeadSize, 'h');
+    sender->SendFile(file, kFileOffset, kSegmentSize);
+    SendFill(sender.get(), kTailSize, 't');
+
+    // Segment is duplicated by SendFile.
+    close(file);
+
+    auto queued_ahead = sender->GetQueuedSendBytes() > kSegmentSize + kTailSize;
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    snet::Timer tick(&timer_list);
+    st.tick = &tick;
+    tick.SetOnTimeout([s] () { s->Tick(); });
+    tick.ExpireFromNow(snet::Milliseconds(1));
+
+    snet::Timer timeout(&timer_list);
+    timeout.SetOnTimeout([loop] () { loop->Stop(); });
+    timeout.ExpireFromNow(snet::Seconds(5));
+
+    event_loop->Loop();
+
+    auto ordered = queued_ahead && st.received == kTotal && st.data_valid;
+    auto resumed = st.partial_file_ticks > 1;
+    auto completed = st.send_completes == 1 && st.complete_after_file &&
+        st.complete_with_empty_queue;
+
+    printf("buffers and file segment in order: %s\n", ordered ? "ok" : "fail");
+    printf("partial sendfile resumed over %d ticks: %s\n",
+           st.partial_file_ticks, resumed ? "ok" : "fail");
+    printf("send complete after the last buffer: %s\n",
+           completed ? "ok" : "fail");
+
+    close(fds[1]);
+    return ordered && resumed && completed ? 0 : 1;
+}
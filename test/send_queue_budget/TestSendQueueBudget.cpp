@@ -0,0 +1,172 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "SendQueueBudget.h"
+#include "SocketOps.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <sys/socket.h>
+#include <memory>
+#include <thread>
+
+namespace
+{
+
+const std::size_t kBufferSize = 16 * 1024;
+const int kStalledBuffers = 16;
+const int kTrickleBacklog = 4;
+
+bool SocketPair(int fds[2])
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return false;
+
+    int size = 16 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    return snet::SetSocketNonBlock(fds[0]) && snet::SetSocketNonBlock(fds[1]);
+}
+
+void SendBuffer(snet::Connection *connection)
+{
+    std::unique_ptr<snet::Buffer> buffer(new snet::Buffer(
+            new char[kBufferSize](), kBufferSize, snet::OpDeleter));
+    connection->Send(std::move(buffer));
+}
+
+struct State
+{
+    snet::EventLoop *loop = nullptr;
+    std::unique_ptr<snet::Connection> stalled;
+    std::unique_ptr<snet::Connection> trickle;
+    int trickle_peer = -1;
+    snet::Timer *tick = nullptr;
+
+    int trickle_errors = 0;
+    std::size_t stalled_evictions = 0;
+    std::size_t trickle_evictions = 0;
+    bool trickle_never_empty = true;
+
+    // Peer of trickle reads a buffer and the sender queues another one,
+    // so the send queue never empties, but its head keeps moving.
+    void Tick()
+    {
+        char buf[kBufferSize];
+        std::size_t bytes = 0;
+        while (bytes < kBufferSize)
+        {
+            auto ret = read(trickle_peer, buf, kBufferSize - bytes);
+            if (ret <= 0)
+                break;
+            bytes += ret;
+        }
+
+        if (trickle->GetQueuedSendBytes() == 0)
+            trickle_never_empty = false;
+
+        SendBuffer(trickle.get());
+        tick->ExpireFromNow(snet::Milliseconds(5));
+    }
+};
+
+// Connection queues bytes in a thread which exits, then it is destroyed
+// in this thread, the process total still drops back.
+bool TotalAcrossThreads()
+{
+    int fds[2];
+    if (!SocketPair(fds))
+        return false;
+
+    auto before = snet::GetTotalQueuedSendBytes();
+    std::unique_ptr<snet::Connection> connection;
+    std::thread thread([&connection, &fds] () {
+        connection.reset(new snet::Connection(fds[0], nullptr));
+        for (int i = 0; i < 4; ++i)
+            SendBuffer(connection.get());
+    });
+    thread.join();
+
+    auto queued = connection->GetQueuedSendBytes();
+    auto counted = snet::GetTotalQueuedSendBytes() - before == queued;
+    connection.reset();
+
+    close(fds[1]);
+    return queued > 0 && counted &&
+        snet::GetTotalQueuedSendBytes() == before;
+}
+
+} // namespace
+
+// Stalled connection stops reading at once, trickle connection reads as
+// fast as it is sent to with a small backlog. Only the stalled one is
+// evicted, though both send queues are never empty. Stalled connection
+// has no OnError, eviction still closes it and drops its send queue.
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    snet::SendQueueBudget budget(1, snet::Milliseconds(150));
+    event_loop->AddLoopHandler(&budget);
+
+    int stalled_fds[2];
+    int trickle_fds[2];
+    if (!SocketPair(stalled_fds) || !SocketPair(trickle_fds))
+        return 1;
+
+    State st;
+    auto s = &st;
+    st.loop = loop;
+    st.stalled.reset(new snet::Connection(stalled_fds[0], loop));
+    st.trickle.reset(new snet::Connection(trickle_fds[0], loop));
+    st.trickle_peer = trickle_fds[1];
+    st.trickle->SetOnError([s] () { ++s->trickle_errors; });
+
+    budget.SetOnEvict([s] (snet::Connection *connection) {
+        if (connection == s->stalled.get())
+            ++s->stalled_evictions;
+        else
+            ++s->trickle_evictions;
+    });
+
+    st.stalled->SetSendQueueBudget(&budget);
+    st.trickle->SetSendQueueBudget(&budget);
+
+    for (int i = 0; i < kStalledBuffers; ++i)
+        SendBuffer(st.stalled.get());
+    for (int i = 0; i < kTrickleBacklog; ++i)
+        SendBuffer(st.trickle.get());
+
+    snet::Timer tick(&timer_list);
+    st.tick = &tick;
+    tick.SetOnTimeout([s] () { s->Tick(); });
+    tick.ExpireFromNow(snet::Milliseconds(5));
+
+    snet::Timer stop(&timer_list);
+    stop.SetOnTimeout([loop] () { loop->Stop(); });
+    stop.ExpireFromNow(snet::Milliseconds(500));
+
+    event_loop->Loop();
+
+    auto stalled_evicted = st.stalled_evictions == 1 &&
+        st.stalled->Fd() < 0 && st.stalled->GetQueuedSendBytes() == 0;
+    auto trickle_kept = st.trickle_evictions == 0 &&
+        st.trickle_errors == 0 && st.trickle->Fd() >= 0 &&
+        st.trickle_never_empty;
+
+    printf("stalled connection evicted: %s\n", stalled_evicted ? "ok" : "fail");
+    printf("trickle connection kept: %s\n", trickle_kept ? "ok" : "fail");
+    printf("evictions: %zu\n", budget.GetEvictions());
+
+    close(stalled_fds[1]);
+    close(trickle_fds[1]);
+    st.stalled.reset();
+    st.trickle.reset();
+
+    auto across_threads = TotalAcrossThreads();
+    printf("total across threads: %s\n", across_threads ? "ok" : "fail");
+
+    return stalled_evicted && trickle_kept && across_threads ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "SocketOps.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <sys/socket.h>
+#include <memory>
+
+namespace
+{
+
+const std::size_t kBufferSize = 64 * 1024;
+const int kBuffers = 16;
+const std::size_t kLowWatermark = 64 * 1024;
+const std::size_t kHighWatermark = 256 * 1024;
+
+bool SocketPair(int fds[2])
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return false;
+
+    int size = 16 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    return snet::SetSocketNonBlock(fds[0]) && snet::SetSocketNonBlock(fds[1]);
+}
+
+struct State
+{
+    std::unique_ptr<snet::Connection> out;
+    std::unique_ptr<snet::Connection> sink;
+    std::unique_ptr<snet::Connection> source;
+    int feeder = -1;
+
+    int highs = 0;
+    int lows = 0;
+    std::size_t sink_bytes = 0;
+    int source_reads = 0;
+    int source_closes = 0;
+    std::size_t source_bytes = 0;
+
+    bool high_paused = false;
+    bool low_kept_user_pause = false;
+    bool resumed = false;
+
+    void SinkRecv()
+    {
+        char buf[16 * 1024];
+        while (true)
+        {
+            snet::Buffer buffer(buf, sizeof(buf));
+            auto ret = sink->Recv(&buffer);
+            if (ret <= 0)
+                break;
+            sink_bytes += ret;
+        }
+    }
+
+    void SourceRecv()
+    {
+        ++source_reads;
+        char buf[256];
+        snet::Buffer buffer(buf, sizeof(buf));
+        auto ret = source->Recv(&buffer);
+        if (ret == static_cast<int>(snet::RecvE::PeerClosed))
+            ++source_closes;
+        else if (ret > 0)
+            source_bytes += ret;
+    }
+};
+
+struct DetachState
+{
+    std::unique_ptr<snet::Connection> out;
+    std::unique_ptr<snet::Connection> source;
+    int source_reads = 0;
+    bool paused = false;
+    bool resumed = false;
+};
+
+// Out pauses source by backpressure, detaching out from the loop, or
+// closing it, releases the pause of source, which stays in the loop.
+bool ReleasesBackpressure(bool detach)
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    int out_fds[2];
+    int in_fds[2];
+    if (!SocketPair(out_fds) || !SocketPair(in_fds))
+        return false;
+
+    DetachState st;
+    auto s = &st;
+    st.out.reset(new snet::Connection(out_fds[0], loop));
+    st.source.reset(new snet::Connection(in_fds[0], loop));
+    st.source->SetOnReceivable([s] () { ++s->source_reads; });
+
+    st.out->SetSendWatermarks(kLowWatermark, kHighWatermark);
+    st.out->SetBackpressureSource(st.source.get());
+    for (int i = 0; i < kBuffers; ++i)
+    {
+        std::unique_ptr<snet::Buffer> buffer(new snet::Buffer(
+                new char[kBufferSize](), kBufferSize, snet::OpDeleter));
+        st.out->Send(std::move(buffer));
+    }
+
+    if (write(in_fds[1], "hello", 5) != 5)
+        return false;
+
+    snet::Timer release(&timer_list);
+    release.SetOnTimeout([s, detach] () {
+        s->paused = s->source_reads == 0;
+        if (detach)
+            s->out->Detach();
+        else
+            s->out->Close();
+    });
+    release.ExpireFromNow(snet::Milliseconds(20));
+
+    snet::Timer stop(&timer_list);
+    stop.SetOnTimeout([s, loop] () {
+        s->resumed = s->source_reads > 0;
+        loop->Stop();
+    });
+    stop.ExpireFromNow(snet::Milliseconds(40));
+
+    event_loop->Loop();
+
+    close(out_fds[1]);
+    close(in_fds[1]);
+    return st.paused && st.resumed;
+}
+
+} // namespace
+
+// Sink is sent to through out, reading of source is paused by the send
+// queue of out. Source is paused by the user too, crossing the low
+// watermark must not resume it, and its reading must not restart after
+// the peer closed.
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    int out_fds[2];
+    int in_fds[2];
+    if (!SocketPair(out_fds) || !SocketPair(in_fds))
+        return 1;
+
+    State st;
+    auto s = &st;
+    st.out.reset(new snet::Connection(out_fds[0], loop));
+    st.sink.reset(new snet::Connection(out_fds[1], loop));
+    st.source.reset(new snet::Connection(in_fds[0], loop));
+    st.feeder = in_fds[1];
+
+    st.out->SetSendWatermarks(kLowWatermark, kHighWatermark);
+    st.out->SetOnHighWatermark([s] () { ++s->highs; });
+    st.out->SetOnLowWatermark([s] () { ++s->lows; });
+    st.out->SetBackpressureSource(st.source.get());
+
+    st.sink->PauseRead();
+    st.sink->SetOnReceivable([s] () { s->SinkRecv(); });
+    st.source->SetOnReceivable([s] () { s->SourceRecv(); });
+
+    if (write(st.feeder, "hello", 5) != 5)
+        return 1;
+
+    st.source->PauseRead();
+    for (int i = 0; i < kBuffers; ++i)
+    {
+        std::unique_ptr<snet::Buffer> buffer(new snet::Buffer(
+                new char[kBufferSize](), kBufferSize, snet::OpDeleter));
+        st.out->Send(std::move(buffer));
+    }
+
+    // Drain the sink, the send queue of out crosses the low watermark.
+    snet::Timer drain(&timer_list);
+    drain.SetOnTimeout([s] () {
+        s->high_paused = s->highs == 1 && s->lows == 0 &&
+            s->source_reads == 0;
+        s->sink->ResumeRead();
+    });
+    drain.ExpireFromNow(snet::Milliseconds(20));
+
+    // Source is still paused by the user, resume it and close its peer.
+    snet::Timer resume(&timer_list);
+    resume.SetOnTimeout([s] () {
+        s->low_kept_user_pause = s->lows == 1 && s->source_reads == 0 &&
+            s->sink_bytes == kBufferSize * kBuffers;
+        s->source->ResumeRead();
+        close(s->feeder);
+    });
+    resume.ExpireFromNow(snet::Milliseconds(80));
+
+    // Pausing and resuming after the peer closed does not rearm reading.
+    snet::Timer rearm(&timer_list);
+    rearm.SetOnTimeout([s] () {
+        s->resumed = s->source_bytes == 5 && s->source_closes == 1;
+        s->source->PauseRead();
+        s->source->ResumeRead();
+    });
+    rearm.ExpireFromNow(snet::Milliseconds(140));
+
+    snet::Timer stop(&timer_list);
+    stop.SetOnTimeout([loop] () { loop->Stop(); });
+    stop.ExpireFromNow(snet::Milliseconds(200));
+
+    event_loop->Loop();
+
+    auto closed_once = st.source_closes == 1;
+    printf("high watermark pauses source: %s\n",
+           st.high_paused ? "ok" : "fail");
+    printf("low watermark keeps user pause: %s\n",
+           st.low_kept_user_pause ? "ok" : "fail");
+    printf("user resume reads source: %s\n", st.resumed ? "ok" : "fail");
+    printf("peer closed reported once: %s (%d reads)\n",
+           closed_once ? "ok" : "fail", st.source_reads);
+
+    auto detach_released = ReleasesBackpressure(true);
+    printf("detach releases backpressure: %s\n",
+           detach_released ? "ok" : "fail");
+    auto close_released = ReleasesBackpressure(false);
+    printf("close releases backpressure: %s\n",
+           close_released ? "ok" : "fail");
+
+    return st.high_paused && st.low_kept_user_pause && st.resumed &&
+        closed_once && detach_released && close_released ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "SocketOps.h"
+#include "Splice.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <memory>
+
+namespace
+{
+
+const std::size_t kQueuedSize = 256 * 1024;
+const char kData[] = "spliced";
+const std::size_t kDataSize = sizeof(kData) - 1;
+
+bool SocketPair(int fds[2])
+{
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        return false;
+
+    int size = 16 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    return snet::SetSocketNonBlock(fds[0]) && snet::SetSocketNonBlock(fds[1]);
+}
+
+struct State
+{
+    snet::EventLoop *loop = nullptr;
+    snet::Connection *to = nullptr;
+    int reader = -1;
+    snet::Timer *tick = nullptr;
+
+    std::size_t data_size = 0;
+    std::size_t received = 0;
+    bool data_valid = true;
+    bool reader_eof = false;
+    int eofs = 0;
+    std::size_t queued_at_eof = 0;
+
+    // Reader reads slowly, so the to connection keeps bytes queued when
+    // the from connection reaches EOF.
+    void Tick()
+    {
+        char buf[8 * 1024];
+        auto ret = read(reader, buf, sizeof(buf));
+        if (ret == 0)
+            reader_eof = true;
+
+        for (ssize_t i = 0; i < ret; ++i, ++received)
+        {
+            auto expected = received < kQueuedSize ?
+                'q' : kData[received - kQueuedSize];
+            if (received >= kQueuedSize + data_size || buf[i] != expected)
+                data_valid = false;
+        }
+
+        if (reader_eof)
+        {
+            // A later writable event must not shutdown or report again.
+            to->WaitWritable();
+            tick->SetOnTimeout([this] () { loop->Stop(); });
+            tick->ExpireFromNow(snet::Milliseconds(20));
+            return ;
+        }
+
+        tick->ExpireFromNow(snet::Milliseconds(1));
+    }
+};
+
+// Buffer queued in the to connection is sent, then the data spliced from
+// the from connection, and the write of to is shutdown once after both.
+// Without data, the from connection reaches EOF while the buffer is still
+// queued.
+bool Relay(std::size_t data_size)
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    int from_fds[2];
+    int to_fds[2];
+    if (!SocketPair(from_fds) || !SocketPair(to_fds))
+        return false;
+
+    std::unique_ptr<snet::Connection> from(
+        new snet::Connection(from_fds[0], loop));
+    std::unique_ptr<snet::Connection> to(
+        new snet::Connection(to_fds[0], loop));
+
+    snet::Splice splice(from.get(), to.get());
+    if (!splice.IsOk())
+        return false;
+
+    State st;
+    auto s = &st;
+    st.loop = loop;
+    st.to = to.get();
+    st.reader = to_fds[1];
+    st.data_size = data_size;
+    splice.SetOnEof([s] () {
+        ++s->eofs;
+        s->queued_at_eof = s->to->GetQueuedSendBytes();
+    });
+
+    std::unique_ptr<snet::Buffer> buffer(
+        new snet::Buffer(new char[kQueuedSize], kQueuedSize, snet::OpDeleter));
+    for (std::size_t i = 0; i < kQueuedSize; ++i)
+        buffer->buf[i] = 'q';
+    to->Send(std::move(buffer));
+
+    if (write(from_fds[1], kData, data_size) !=
+        static_cast<ssize_t>(data_size))
+        return false;
+    close(from_fds[1]);
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    snet::Timer tick(&timer_list);
+    st.tick = &tick;
+    tick.SetOnTimeout([s] () { s->Tick(); });
+    tick.ExpireFromNow(snet::Milliseconds(20));
+
+    snet::Timer timeout(&timer_list);
+    timeout.SetOnTimeout([loop] () { loop->Stop(); });
+    timeout.ExpireFromNow(snet::Seconds(2));
+
+    event_loop->Loop();
+
+    auto all_sent = st.received == kQueuedSize + data_size &&
+        st.data_valid && st.reader_eof;
+    auto eof_once = st.eofs == 1 && st.queued_at_eof == 0;
+
+    printf("%zu bytes spliced, queued data sent before shutdown: %s "
+           "(%zu bytes)\n", data_size, all_sent ? "ok" : "fail", st.received);
+    printf("%zu bytes spliced, eof reported once after the queue "
+           "drained: %s (%d)\n", data_size, eof_once ? "ok" : "fail", st.eofs);
+
+    close(to_fds[1]);
+    return all_sent && eof_once;
+}
+
+} // namespace
+
+int main()
+{
+    auto without_data = Relay(0);
+    auto with_data = Relay(kDataSize);
+    return without_data && with_data ? 0 : 1;
+}
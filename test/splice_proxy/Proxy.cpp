@@ -0,0 +1,164 @@
+#include "Acceptor.h"
+#include "Connector.h"
+#include "Connection.h"
+#include "EventLoop.h"
+#include "Splice.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Session final
+{
+public:
+    using OnClose = std::function<void ()>;
+
+    Session(std::unique_ptr<snet::Connection> client,
+            const std::string &ip, unsigned short port,
+            snet::EventLoop *loop)
+        : eof_count_(0),
+          client_(std::move(client)),
+          connector_(ip, port, loop)
+    {
+    }
+
+    Session(const Session &) = delete;
+    void operator = (const Session &) = delete;
+
+    void Start(const OnClose &on_close)
+    {
+        on_close_ = on_close;
+        client_->PauseRead();
+        client_->SetOnError([this] () { on_close_(); });
+
+        connector_.Connect(
+            [this] (std::unique_ptr<snet::Connection> server) {
+                HandleConnect(std::move(server));
+            });
+    }
+
+private:
+    void HandleConnect(std::unique_ptr<snet::Connection> server)
+    {
+        if (!server)
+            return on_close_();
+
+        server_ = std::move(server);
+        server_->SetOnError([this] () { on_close_(); });
+
+        upstream_.reset(new snet::Splice(client_.get(), server_.get()));
+        downstream_.reset(new snet::Splice(server_.get(), client_.get()));
+
+        if (!upstream_->IsOk() || !downstream_->IsOk())
+            return on_close_();
+
+        upstream_->SetOnEof([this] () { HandleEof(); });
+        upstream_->SetOnError([this] () { on_close_(); });
+        downstream_->SetOnEof([this] () { HandleEof(); });
+        downstream_->SetOnError([this] () { on_close_(); });
+
+        client_->ResumeRead();
+    }
+
+    void HandleEof()
+    {
+        if (++eof_count_ == 2)
+            on_close_();
+    }
+
+    int eof_count_;
+    OnClose on_close_;
+    std::unique_ptr<snet::Connection> client_;
+    std::unique_ptr<snet::Connection> server_;
+    std::unique_ptr<snet::Splice> upstream_;
+    std::unique_ptr<snet::Splice> downstream_;
+    snet::Connector connector_;
+};
+
+// Sessions are closed in their callbacks, destroy them after the events
+// have been handled.
+class Proxy final : public snet::LoopHandler
+{
+public:
+    Proxy(const char *ip, unsigned short port,
+          const char *target_ip, unsigned short target_port,
+          snet::EventLoop *loop)
+        : id_generator_(0),
+          target_ip_(target_ip),
+          target_port_(target_port),
+          loop_(loop),
+          acceptor_(ip, port, loop)
+    {
+        acceptor_.SetOnNewConnection(
+            [this] (std::unique_ptr<snet::Connection> connection) {
+                HandleNewConnection(std::move(connection));
+            });
+    }
+
+    Proxy(const Proxy &) = delete;
+    void operator = (const Proxy &) = delete;
+
+    bool IsListenOk() const
+    {
+        return acceptor_.IsListenOk();
+    }
+
+    virtual void HandleLoop() override
+    {
+        for (auto id : closed_)
+            sessions_.erase(id);
+        closed_.clear();
+    }
+
+    virtual void HandleStop() override { }
+
+private:
+    void HandleNewConnection(std::unique_ptr<snet::Connection> connection)
+    {
+        auto id = ++id_generator_;
+        std::unique_ptr<Session> session(
+            new Session(std::move(connection),
+                        target_ip_, target_port_, loop_));
+
+        auto s = session.get();
+        sessions_.emplace(id, std::move(session));
+        s->Start([this, id] () { closed_.push_back(id); });
+    }
+
+    unsigned long long id_generator_;
+    std::string target_ip_;
+    unsigned short target_port_;
+    snet::EventLoop *loop_;
+    snet::Acceptor acceptor_;
+
+    std::vector<unsigned long long> closed_;
+    std::unordered_map<unsigned long long, std::unique_ptr<Session>> sessions_;
+};
+
+int main(int argc, const char **argv)
+{
+    if (argc != 5)
+    {
+        fprintf(stderr, "Usage: %s listen_ip port target_ip target_port\n",
+                argv[0]);
+        return 1;
+    }
+
+    auto event_loop = snet::CreateEventLoop();
+    Proxy proxy(argv[1], atoi(argv[2]), argv[3], atoi(argv[4]),
+                event_loop.get());
+
+    if (!proxy.IsListenOk())
+    {
+        fprintf(stderr, "Listen %s:%s error\n", argv[1], argv[2]);
+        return 1;
+    }
+
+    event_loop->AddLoopHandler(&proxy);
+    event_loop->Loop();
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "SpscRing.h"
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+
+const int kMessages = 1000000;
+const std::size_t kBatch = 32;
+
+bool TestBounded()
+{
+    snet::SpscRing<int> ring(6);
+    if (ring.Capacity() != 8)
+        return false;
+
+    int items[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    if (ring.TryPushBatch(items, 10) != 8 || ring.TryPush(8))
+        return false;
+
+    int out[4];
+    if (ring.TryPopBatch(out, 4) != 4 || out[0] != 0 || out[3] != 3)
+        return false;
+
+    // Space freed by the consumer is seen by the producer, indexes wrap.
+    if (!ring.TryPush(8) || !ring.TryPush(9))
+        return false;
+
+    int value = -1;
+    for (int expect = 4; expect < 10; ++expect)
+    {
+        if (!ring.TryPop(&value) || value != expect)
+            return false;
+    }
+
+    return !ring.TryPop(&value);
+}
+
+// Producer pushes one by one and in batches, consumer pops in batches,
+// both sides wait for each other through the small ring.
+bool TestPipeline()
+{
+    snet::SpscRing<int> ring(64);
+
+    std::thread producer([&ring] () {
+        int batch[kBatch];
+        int next = 0;
+        while (next < kMessages)
+        {
+            if (next % 2)
+            {
+                ring.Push(next++);
+                continue;
+            }
+
+            std::size_t n = 0;
+            while (n < kBatch && next < kMessages)
+                batch[n++] = next++;
+            ring.PushBatch(batch, n);
+        }
+    });
+
+    int items[kBatch];
+    int expect = 0;
+    bool ordered = true;
+    while (expect < kMessages)
+    {
+        auto n = ring.PopBatch(items, kBatch);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (items[i] != expect++)
+                ordered = false;
+        }
+    }
+
+    producer.join();
+    return ordered;
+}
+
+// Consumer parks while the producer sleeps, and is woken by a push.
+bool TestPark()
+{
+    snet::SpscRing<int> ring(4);
+
+    std::thread producer([&ring] () {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ring.Push(42);
+    });
+
+    auto begin = std::chrono::steady_clock::now();
+    auto value = ring.Pop();
+    auto waited = std::chrono::steady_clock::now() - begin;
+
+    producer.join();
+    return value == 42 && waited >= std::chrono::milliseconds(50);
+}
+
+} // namespace
+
+int main()
+{
+    auto bounded = TestBounded();
+    auto pipeline = TestPipeline();
+    auto park = TestPark();
+
+    printf("bounded: %s\n", bounded ? "ok" : "fail");
+    printf("pipeline of %d messages: %s\n", kMessages,
+           pipeline ? "ok" : "fail");
+    printf("park: %s\n", park ? "ok" : "fail");
+
+    return bounded && pipeline && park ? 0 : 1;
+}
@@ -9,7 +9,8 @@ Client::Client(unsigned short port, snet::EventLoop *loop,
     : loop_(loop),
       addrinfo_resolver_(addrinfo_resolver),
       request_(nullptr),
-      port_(port)
+      port_(port),
+      recv_paused_(false)
 {
 }
 
@@ -60,6 +61,20 @@ void Client::ShutdownWrite()
     connection_->Shutdown(snet::ShutdownT::Write);
 }
 
+void Client::PauseRecv()
+{
+    recv_paused_ = true;
+    if (connection_)
+        connection_->PauseRead();
+}
+
+void Client::ResumeRecv()
+{
+    recv_paused_ = false;
+    if (connection_)
+        connection_->ResumeRead();
+}
+
 void Client::Connect(const snet::AddrInfoResolver::SockAddrs &addrs)
 {
     for (auto addr : addrs)
@@ -100,6 +115,9 @@ void Client::HandleConnect(std::unique_ptr<snet::Connection> connection)
     connection_->SetOnReceivable(
         [this] () { HandleReceivable(); });
 
+    if (recv_paused_)
+        connection_->PauseRead();
+
     event_handler_(Event::ConnectServerSuccess);
 }
 
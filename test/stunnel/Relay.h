@@ -43,6 +43,8 @@ public:
     bool GetPeerAddress(struct sockaddr_in *inet);
     void Send(std::unique_ptr<snet::Buffer> buffer);
     void ShutdownWrite();
+    void PauseRecv();
+    void ResumeRecv();
 
 private:
     void Connect(const snet::AddrInfoResolver::SockAddrs &addrs);
@@ -61,6 +63,7 @@ private:
 
     std::string ip_;
     unsigned short port_;
+    bool recv_paused_;
     EventHandler event_handler_;
     DataHandler data_handler_;
     std::queue<struct sockaddr_in> addrs_;
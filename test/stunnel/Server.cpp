@@ -17,12 +17,17 @@ public:
                       snet::AddrInfoResolver *addrinfo_resolver)
         : loop_(loop),
           addrinfo_resolver_(addrinfo_resolver),
+          relays_paused_(false),
           tunnel_(std::move(connection))
     {
         tunnel_->SetDataHandler(
             [this] (std::unique_ptr<snet::Buffer> data) {
                 HandleTunnelData(std::move(data));
             });
+        tunnel_->SetSendWatermarks(
+            kLowWatermark, kHighWatermark,
+            [this] () { PauseRelays(); },
+            [this] () { ResumeRelays(); });
     }
 
     STunnelConnection(const STunnelConnection &) = delete;
@@ -82,6 +87,9 @@ private:
             });
         rclient->ConnectHost(host);
 
+        if (relays_paused_)
+            rclient->PauseRecv();
+
         relays_.emplace(id, std::move(rclient));
     }
 
@@ -155,8 +163,28 @@ private:
         tunnel_->Send(stunnel::PackData(id, *data));
     }
 
+    // Stop reading from relays when the tunnel can not send as fast as
+    // relays receive.
+    void PauseRelays()
+    {
+        relays_paused_ = true;
+        for (auto &relay : relays_)
+            relay.second->PauseRecv();
+    }
+
+    void ResumeRelays()
+    {
+        relays_paused_ = false;
+        for (auto &relay : relays_)
+            relay.second->ResumeRecv();
+    }
+
+    static const std::size_t kLowWatermark = 1024 * 1024;
+    static const std::size_t kHighWatermark = 4 * 1024 * 1024;
+
     snet::EventLoop *loop_;
     snet::AddrInfoResolver *addrinfo_resolver_;
+    bool relays_paused_;
 
     std::unique_ptr<tunnel::Connection> tunnel_;
     std::unordered_map<unsigned long long,
@@ -45,6 +45,15 @@ void Connection::SetDataHandler(const DataHandler &data_handler)
     data_handler_ = data_handler;
 }
 
+void Connection::SetSendWatermarks(std::size_t low, std::size_t high,
+                                   WatermarkHandler on_high,
+                                   WatermarkHandler on_low)
+{
+    connection_->SetSendWatermarks(low, high);
+    connection_->SetOnHighWatermark(std::move(on_high));
+    connection_->SetOnLowWatermark(std::move(on_low));
+}
+
 void Connection::Handshake(const OnHandshakeOk &oh)
 {
     if (state_ == State::Connecting)
@@ -269,9 +278,10 @@ void Client::SetDataHandler(const DataHandler &data_handler)
 
 void Client::Connect(const OnConnected &onc)
 {
+    on_connected_ = onc;
     connector_.Connect(
-        [this, onc] (std::unique_ptr<snet::Connection> connection) {
-            HandleConnect(std::move(connection), onc);
+        [this] (std::unique_ptr<snet::Connection> connection) {
+            HandleConnect(std::move(connection));
         });
 }
 
@@ -281,8 +291,7 @@ void Client::Send(std::unique_ptr<snet::Buffer> buffer)
         connection_->Send(std::move(buffer));
 }
 
-void Client::HandleConnect(std::unique_ptr<snet::Connection> connection,
-                           const OnConnected &onc)
+void Client::HandleConnect(std::unique_ptr<snet::Connection> connection)
 {
     if (connection)
     {
@@ -291,7 +300,7 @@ void Client::HandleConnect(std::unique_ptr<snet::Connection> connection,
                                          Connection::State::Connecting));
         connection_->SetErrorHandler(error_handler_);
         connection_->SetDataHandler(data_handler_);
-        connection_->Handshake(onc);
+        connection_->Handshake(on_connected_);
     }
     else
     {
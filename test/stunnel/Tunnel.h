@@ -7,6 +7,7 @@
 #include "Connection.h"
 #include "EventLoop.h"
 #include "Timer.h"
+#include <functional>
 
 namespace tunnel
 {
@@ -25,6 +26,7 @@ public:
     using OnHandshakeOk = std::function<void ()>;
     using ErrorHandler = std::function<void ()>;
     using DataHandler = std::function<void (std::unique_ptr<snet::Buffer>)>;
+    using WatermarkHandler = snet::Connection::OnHighWatermark;
 
     Connection(std::unique_ptr<snet::Connection> connection,
                const std::string &key, snet::TimerList *timer_list,
@@ -35,6 +37,9 @@ public:
 
     void SetErrorHandler(const ErrorHandler &error_handler);
     void SetDataHandler(const DataHandler &data_handler);
+    void SetSendWatermarks(std::size_t low, std::size_t high,
+                           WatermarkHandler on_high,
+                           WatermarkHandler on_low);
     void Handshake(const OnHandshakeOk &oh);
     void Send(std::unique_ptr<snet::Buffer> buffer);
 
@@ -92,13 +97,13 @@ public:
     void Send(std::unique_ptr<snet::Buffer> buffer);
 
 private:
-    void HandleConnect(std::unique_ptr<snet::Connection> connection,
-                       const OnConnected &onc);
+    void HandleConnect(std::unique_ptr<snet::Connection> connection);
 
     std::string key_;
     snet::TimerList *timer_list_;
     snet::Connector connector_;
 
+    OnConnected on_connected_;
     ErrorHandler error_handler_;
     DataHandler data_handler_;
     std::unique_ptr<Connection> connection_;
@@ -0,0 +1,293 @@
+#include "Connection.h"
+#include "EventLoop.h"
+#include "SocketOps.h"
+#include "Timer.h"
+#include <stdio.h>
+#include <memory>
+
+namespace
+{
+
+const std::size_t kBufferSize = 256 * 1024;
+
+int destructed = 0;
+
+void CountingDeleter(snet::Buffer *buffer)
+{
+    delete [] buffer->buf;
+    ++destructed;
+}
+
+// Connect a pair of TCP sockets through loopback.
+bool TcpPair(int fds[2])
+{
+    auto listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0)
+        return false;
+
+    struct sockaddr_in addr;
+    snet::SetSockAddrIn(&addr, "127.0.0.1", 0);
+    socklen_t len = sizeof(addr);
+
+    auto sa = reinterpret_cast<struct sockaddr *>(&addr);
+    bool ok = bind(listener, sa, sizeof(addr)) == 0 &&
+        listen(listener, 1) == 0 &&
+        getsockname(listener, sa, &len) == 0;
+
+    fds[0] = fds[1] = -1;
+    if (ok)
+    {
+        fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+        ok = fds[0] >= 0 && connect(fds[0], sa, sizeof(addr)) == 0;
+    }
+    if (ok)
+    {
+        fds[1] = accept(listener, nullptr, nullptr);
+        ok = fds[1] >= 0;
+    }
+
+    close(listener);
+    return ok && snet::SetSocketNonBlock(fds[0]) &&
+        snet::SetSocketNonBlock(fds[1]);
+}
+
+void SendPattern(snet::Connection *connection, char seed)
+{
+    auto buf = new char[kBufferSize];
+    for (std::size_t i = 0; i < kBufferSize; ++i)
+        buf[i] = static_cast<char>(seed + i % 251);
+
+    std::unique_ptr<snet::Buffer> buffer(
+        new snet::Buffer(buf, kBufferSize, CountingDeleter));
+    connection->Send(std::move(buffer));
+}
+
+struct State
+{
+    std::unique_ptr<snet::Connection> sender;
+    int peer = -1;
+    snet::Timer *tick = nullptr;
+    snet::EventLoop *loop = nullptr;
+
+    int phase = 0;
+    std::size_t received = 0;
+    char seed = 0;
+    bool peer_eof = false;
+    bool data_valid = true;
+
+    int send_completes = 0;
+    int destructed_at_send_complete = -1;
+    bool alive_before_read = false;
+    bool alive_after_close = false;
+
+    // Read what the sender has sent, checking it against the pattern.
+    void Drain()
+    {
+        char buf[16 * 1024];
+        while (true)
+        {
+            auto ret = read(peer, buf, sizeof(buf));
+            if (ret == 0)
+                peer_eof = true;
+            if (ret <= 0)
+                break;
+
+            for (ssize_t i = 0; i < ret; ++i, ++received)
+            {
+                auto offset = received % kBufferSize;
+                if (buf[i] != static_cast<char>(seed + offset % 251))
+                    data_valid = false;
+            }
+        }
+    }
+
+    // Phase 0 sends a buffer and waits for the completion, phase 1 sends
+    // a buffer and closes the sender before the peer reads.
+    void Tick()
+    {
+        switch (phase)
+        {
+        case 0:
+            alive_before_read = destructed == 0 && send_completes == 0;
+            phase = 1;
+            break;
+
+        case 1:
+            Drain();
+            if (received == kBufferSize && send_completes == 1)
+            {
+                received = 0;
+                seed = 7;
+                SendPattern(sender.get(), seed);
+                sender->Close();
+                phase = 2;
+            }
+            break;
+
+        case 2:
+            alive_after_close = destructed == 1;
+            phase = 3;
+            break;
+
+        case 3:
+            Drain();
+            if (peer_eof && destructed == 2)
+                return loop->Stop();
+            break;
+        }
+
+        tick->ExpireFromNow(snet::Milliseconds(5));
+    }
+};
+
+const std::size_t kTailBufferSize = 4 * 1024 * 1024;
+
+struct TailState
+{
+    std::unique_ptr<snet::Connection> sender;
+    int peer = -1;
+    snet::EventLoop *loop = nullptr;
+    snet::Timer *tick = nullptr;
+
+    std::size_t received = 0;
+    int destructed_before = 0;
+    int send_completes = 0;
+    int destructed_at_send_complete = -1;
+
+    void Tick()
+    {
+        char buf[64 * 1024];
+        while (true)
+        {
+            auto ret = read(peer, buf, sizeof(buf));
+            if (ret <= 0)
+                break;
+            received += ret;
+        }
+
+        if (received == kTailBufferSize && send_completes > 0)
+            return loop->Stop();
+        tick->ExpireFromNow(snet::Milliseconds(1));
+    }
+};
+
+// Threshold is the whole buffer, so only its first write goes by
+// zero-copy and the rest is sent by copy. The completion of the first
+// write arrives while the buffer is still queued, it must still be
+// counted when the buffer is released.
+bool PartialZeroCopyTail()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    int fds[2];
+    if (!TcpPair(fds))
+        return false;
+
+    int size = 64 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    TailState st;
+    auto s = &st;
+    st.loop = loop;
+    st.peer = fds[1];
+    st.destructed_before = destructed;
+    st.sender.reset(new snet::Connection(fds[0], loop));
+    st.sender->EnableZeroCopy(kTailBufferSize);
+    st.sender->SetOnSendComplete([s] () {
+        ++s->send_completes;
+        s->destructed_at_send_complete = destructed - s->destructed_before;
+    });
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    std::unique_ptr<snet::Buffer> buffer(new snet::Buffer(
+            new char[kTailBufferSize](), kTailBufferSize, CountingDeleter));
+    st.sender->Send(std::move(buffer));
+    auto partial = st.sender->GetQueuedSendBytes() > 0;
+
+    snet::Timer tick(&timer_list);
+    st.tick = &tick;
+    tick.SetOnTimeout([s] () { s->Tick(); });
+    tick.ExpireFromNow(snet::Milliseconds(1));
+
+    snet::Timer timeout(&timer_list);
+    timeout.SetOnTimeout([loop] () { loop->Stop(); });
+    timeout.ExpireFromNow(snet::Seconds(2));
+
+    event_loop->Loop();
+
+    st.sender.reset();
+    close(fds[1]);
+    return partial && st.received == kTailBufferSize &&
+        st.send_completes == 1 && st.destructed_at_send_complete == 1;
+}
+
+} // namespace
+
+// Buffers sent by zero-copy live until the kernel completes them, and
+// OnSendComplete waits for the completion. A closed connection leaves
+// its socket lingering in the loop, which destructs the buffer once the
+// peer has read it.
+int main()
+{
+    auto event_loop = snet::CreateEventLoop();
+    auto loop = event_loop.get();
+
+    int fds[2];
+    if (!TcpPair(fds))
+        return 1;
+
+    State st;
+    auto s = &st;
+    st.loop = loop;
+    st.peer = fds[1];
+    st.sender.reset(new snet::Connection(fds[0], loop));
+
+    if (!st.sender->EnableZeroCopy())
+    {
+        printf("zero-copy is not supported\n");
+        return 0;
+    }
+
+    st.sender->SetOnSendComplete([s] () {
+        ++s->send_completes;
+        s->destructed_at_send_complete = destructed;
+    });
+
+    snet::TimerList timer_list;
+    snet::TimerDriver timer_driver(timer_list, loop);
+    event_loop->AddLoopHandler(&timer_driver);
+
+    SendPattern(st.sender.get(), st.seed);
+
+    snet::Timer tick(&timer_list);
+    st.tick = &tick;
+    tick.SetOnTimeout([s] () { s->Tick(); });
+    tick.ExpireFromNow(snet::Milliseconds(5));
+
+    snet::Timer timeout(&timer_list);
+    timeout.SetOnTimeout([loop] () { loop->Stop(); });
+    timeout.ExpireFromNow(snet::Seconds(2));
+
+    event_loop->Loop();
+
+    auto send_complete = st.alive_before_read && st.send_completes == 1 &&
+        st.destructed_at_send_complete == 1;
+    auto linger = st.alive_after_close && st.peer_eof && destructed == 2;
+
+    printf("send complete after zero-copy completion: %s\n",
+           send_complete ? "ok" : "fail");
+    printf("buffer kept after close until completion: %s\n",
+           linger ? "ok" : "fail");
+    printf("data: %s\n", st.data_valid ? "ok" : "fail");
+
+    auto tail = PartialZeroCopyTail();
+    printf("zero-copy head with copied tail completes: %s\n",
+           tail ? "ok" : "fail");
+
+    close(fds[1]);
+    return send_complete && linger && st.data_valid && tail ? 0 : 1;
+}